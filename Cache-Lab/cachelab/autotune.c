@@ -0,0 +1,310 @@
+/*
+ * autotune.c - Searches the tiled transpose kernels of tile.c for the
+ *     best parameters for each given matrix shape and cache, and writes
+ *     them out as the dispatch table read by tileLookup.
+ *
+ * Every candidate (tile height and width, visiting order, diagonal
+ * handling and buffering scheme) is run once through the instrumented
+ * build of the kernels and its accesses to A and B are simulated on the
+ * target cache, exactly as test-trans does. Candidates are ranked by
+ * misses; ties are broken by the wall time of the normal build, in
+ * nanoseconds per element.
+ *
+ * Usage: ./autotune [-s <s>] [-E <E>] [-b <b>] [-n <top>] [-o <file>] MxN...
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include "cachelab.h"
+#include "cachesim.h"
+#include "memtrace.h"
+#include "tile.h"
+
+/* Maximum array dimension, as in test-trans */
+#define MAXN 256
+
+/* Wall time is the best of this many runs of at least MIN_NS each */
+#define TIME_RUNS 3
+#define MIN_NS 1000000
+
+/* A candidate and its score */
+typedef struct {
+    tile_params_t params;
+    int misses;
+    double ns;              /* per element */
+} candidate_t;
+
+/* Target cache */
+static int s = 5, E = 1, b = 5;
+
+/* Matrices laid out like test-trans's, so counts agree with it */
+static int (*matrices)[MAXN][MAXN];
+
+/*
+ * is_transpose - Check that B is the transpose of A
+ */
+static int is_transpose(int M, int N, int A[N][M], int B[M][N])
+{
+    int i, j;
+    for (i = 0; i < N; i++)
+        for (j = 0; j < M; j++)
+            if (A[i][j] != B[j][i])
+                return 0;
+    return 1;
+}
+
+/*
+ * simulate - Trace one run of the kernel and return its misses, or -1
+ *     if the result is not a transpose
+ */
+static int simulate(const tile_params_t *p, int M, int N)
+{
+    int (*A)[M] = (int (*)[M])matrices[0];
+    int (*B)[N] = (int (*)[N])matrices[1];
+    unsigned long long int base = (unsigned long long int)matrices;
+    mem_access_t *trace;
+    cache_t cache;
+    int k, count, misses;
+
+    initMatrix(M, N, A, B);
+    memtraceClearRegions();
+    memtraceAddRegion(A, sizeof(int) * M * N);
+    memtraceAddRegion(B, sizeof(int) * M * N);
+    memtraceStart();
+    tileTransposeTraced(p, M, N, A, B);
+    trace = memtraceStop(&count);
+
+    if (!is_transpose(M, N, A, B))
+        return -1;
+
+    if (cacheInit(&cache, s, E, b, POLICY_LRU) < 0) {
+        fprintf(stderr, "autotune: unsupported cache geometry\n");
+        exit(1);
+    }
+    for (k = 0; k < count; k++)
+        cacheAccess(&cache, trace[k].addr - base, trace[k].op == 'S', 0, NULL);
+    misses = cache.misses;
+    cacheFree(&cache);
+    return misses;
+}
+
+/*
+ * elapsed_ns - Nanoseconds between two clock readings
+ */
+static double elapsed_ns(struct timespec *start, struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+/*
+ * measure - Time the normal build of the kernel in ns per element
+ */
+static double measure(const tile_params_t *p, int M, int N)
+{
+    int (*A)[M] = (int (*)[M])matrices[0];
+    int (*B)[N] = (int (*)[N])matrices[1];
+    struct timespec start, end;
+    double ns, best = 0;
+    long reps;
+    int run;
+
+    for (run = 0; run < TIME_RUNS; run++) {
+        reps = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        do {
+            tileTranspose(p, M, N, A, B);
+            reps++;
+            clock_gettime(CLOCK_MONOTONIC, &end);
+        } while (elapsed_ns(&start, &end) < MIN_NS);
+        ns = elapsed_ns(&start, &end) / reps / ((double)M * N);
+        if (run == 0 || ns < best)
+            best = ns;
+    }
+    return best;
+}
+
+static int compare_candidates(const void *x, const void *y)
+{
+    const candidate_t *c1 = x, *c2 = y;
+    if (c1->misses != c2->misses)
+        return c1->misses < c2->misses ? -1 : 1;
+    return c1->ns < c2->ns ? -1 : c1->ns > c2->ns;
+}
+
+/*
+ * add_size - Append size to the list of tile sizes if it is new and fits
+ */
+static int add_size(int *sizes, int count, int size, int limit)
+{
+    int i;
+    if (size > limit)
+        return count;
+    for (i = 0; i < count; i++)
+        if (sizes[i] == size)
+            return count;
+    sizes[count] = size;
+    return count + 1;
+}
+
+/*
+ * tile_sizes - Powers of two up to the dimension, the dimension itself
+ *     and a few odd sizes that break up conflicts on odd shapes
+ */
+static int tile_sizes(int *sizes, int limit)
+{
+    static const int extra[] = {12, 14, 16, 17, 18, 20, 23, 24};
+    int count = 0, i;
+
+    for (i = 1; i <= limit; i *= 2)
+        count = add_size(sizes, count, i, limit);
+    for (i = 0; i < (int)(sizeof(extra) / sizeof(extra[0])); i++)
+        count = add_size(sizes, count, extra[i], limit);
+    return add_size(sizes, count, limit, limit);
+}
+
+/*
+ * tune - Score every valid candidate for a shape. Returns how many there
+ *     are; the array, best first, goes in *out.
+ */
+static int tune(int M, int N, candidate_t **out)
+{
+    int hs[32], ws[32], nh = tile_sizes(hs, N), nw = tile_sizes(ws, M);
+    int h, w, order, diag, buffered, count = 0;
+    candidate_t *c = malloc(nh * nw * 2 * 2 * 3 * sizeof(candidate_t));
+
+    if (c == NULL) {
+        fprintf(stderr, "autotune: out of memory\n");
+        exit(1);
+    }
+    for (h = 0; h < nh; h++)
+        for (w = 0; w < nw; w++)
+            for (order = TILE_ROW_ORDER; order <= TILE_COL_ORDER; order++)
+                for (buffered = TILE_BUF_NONE; buffered <= TILE_BUF_SPLIT; buffered++)
+                    for (diag = 0; diag <= (buffered == TILE_BUF_NONE); diag++) {
+                        tile_params_t p = {hs[h], ws[w], order, diag, buffered};
+                        if (!tileValid(&p, M, N))
+                            continue;
+                        c[count].params = p;
+                        if ((c[count].misses = simulate(&p, M, N)) < 0) {
+                            fprintf(stderr, "autotune: candidate %dx%d order %d diag %d buffered %d is wrong\n",
+                                    p.th, p.tw, p.order, p.diag, p.buffered);
+                            exit(1);
+                        }
+                        c[count].ns = measure(&p, M, N);
+                        count++;
+                    }
+
+    qsort(c, count, sizeof(candidate_t), compare_candidates);
+    *out = c;
+    return count;
+}
+
+static const char *order_names[] = {"TILE_ROW_ORDER", "TILE_COL_ORDER"};
+static const char *buffer_names[] = {"TILE_BUF_NONE", "TILE_BUF_ROW", "TILE_BUF_SPLIT"};
+
+/*
+ * print_candidate - One line of the ranking
+ */
+static void print_candidate(const candidate_t *c)
+{
+    printf("  %3dx%-3d %-4s diag=%d %-5s misses:%-6d %6.2f ns/elem\n",
+           c->params.th, c->params.tw, c->params.order == TILE_ROW_ORDER ? "row" : "col",
+           c->params.diag, buffer_names[c->params.buffered] + 9, c->misses, c->ns);
+}
+
+static void usage(char *argv[])
+{
+    printf("Usage: %s [-h] [-s <s>] [-E <E>] [-b <b>] [-n <top>] [-o <file>] MxN...\n", argv[0]);
+    printf("Options:\n");
+    printf("  -s, -E, -b   Cache to tune for (default s=5, E=1, b=5)\n");
+    printf("  -n <top>     Candidates to list per shape (default 5)\n");
+    printf("  -o <file>    Write the dispatch table to file (e.g. tile-table.c)\n");
+    printf("Example: %s -o tile-table.c 32x32 64x64 61x67\n", argv[0]);
+}
+
+int main(int argc, char *argv[])
+{
+    char *table_name = NULL;
+    int top = 5, i, k, count, M, N, nshapes;
+    candidate_t **best;
+    FILE *fp;
+    char c;
+
+    while ((c = getopt(argc, argv, "s:E:b:n:o:h")) != -1) {
+        switch (c) {
+        case 's': s = atoi(optarg); break;
+        case 'E': E = atoi(optarg); break;
+        case 'b': b = atoi(optarg); break;
+        case 'n': top = atoi(optarg); break;
+        case 'o': table_name = optarg; break;
+        case 'h':
+            usage(argv);
+            exit(0);
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+    nshapes = argc - optind;
+    if (nshapes == 0) {
+        usage(argv);
+        exit(1);
+    }
+
+    if (posix_memalign((void **)&matrices, 4096, 2 * sizeof(*matrices)) != 0) {
+        fprintf(stderr, "autotune: out of memory\n");
+        exit(1);
+    }
+
+    best = malloc(nshapes * sizeof(candidate_t *));
+    for (i = 0; i < nshapes; i++) {
+        candidate_t *ranked;
+        char *shape = argv[optind + i];
+
+        if (sscanf(shape, "%dx%d", &M, &N) != 2 || M <= 0 || N <= 0 ||
+            M > MAXN || N > MAXN) {
+            fprintf(stderr, "autotune: bad shape %s (max %dx%d)\n", shape, MAXN, MAXN);
+            exit(1);
+        }
+        count = tune(M, N, &ranked);
+        printf("M=%d N=%d (s=%d, E=%d, b=%d): %d candidates\n", M, N, s, E, b, count);
+        for (k = 0; k < top && k < count; k++)
+            print_candidate(&ranked[k]);
+
+        best[i] = malloc(sizeof(candidate_t));
+        *best[i] = ranked[0];
+        free(ranked);
+    }
+
+    if (table_name) {
+        if ((fp = fopen(table_name, "w")) == NULL) {
+            perror(table_name);
+            exit(1);
+        }
+        fprintf(fp, "/*\n * %s - Tiling parameters chosen by ./autotune. Do not edit;\n", table_name);
+        fprintf(fp, " *     regenerate with:\n *\n *     ");
+        for (i = 0; i < argc; i++)
+            fprintf(fp, "%s%s", i ? " " : "", argv[i]);
+        fprintf(fp, "\n */\n#include \"tile.h\"\n\n");
+        fprintf(fp, "const tile_entry_t tile_table[] = {\n");
+        for (i = 0; i < nshapes; i++) {
+            sscanf(argv[optind + i], "%dx%d", &M, &N);
+            fprintf(fp, "    {%d, %d, %d, %d, %d, {%d, %d, %s, %d, %s}}, /* %d misses */\n",
+                    M, N, s, E, b, best[i]->params.th, best[i]->params.tw,
+                    order_names[best[i]->params.order], best[i]->params.diag,
+                    buffer_names[best[i]->params.buffered], best[i]->misses);
+        }
+        fprintf(fp, "};\n\nconst int tile_table_size = %d;\n", nshapes);
+        fclose(fp);
+    }
+
+    for (i = 0; i < nshapes; i++)
+        free(best[i]);
+    free(best);
+    memtraceFree();
+    free(matrices);
+    return 0;
+}
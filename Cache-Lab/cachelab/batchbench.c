@@ -0,0 +1,207 @@
+/*
+ * batchbench.c - Compares the batched transpose of simd.c with one call
+ *     per matrix, for large batches of tiny matrices.
+ *
+ * For each shape, count matrices are stored back to back and transposed
+ * three ways: a loop calling transpose_submit on each matrix through a
+ * function pointer (as the test harness does), a loop calling
+ * simdTranspose on each, and one simdTransposeBatch call for the lot.
+ * Each is the best of several runs, reported in nanoseconds per matrix
+ * and as a speedup over the transpose_submit loop. Unless -n is given
+ * the batch holds 16M ints, far more than the caches.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include "simd.h"
+
+#define TIME_RUNS 5
+
+/* Ints in a batch when -n is not given */
+#define BATCH_INTS (1 << 24)
+
+/* Shapes measured when no -M/-N is given */
+static const int default_shapes[][2] = {
+    {4, 4}, {8, 8}, {16, 16}, {32, 32}, {4, 8}, {12, 20}, {31, 17}
+};
+
+/* External function defined in trans.c */
+extern void transpose_submit(int M, int N, int A[N][M], int B[M][N]);
+
+typedef void (*trans_t)(int M, int N, int A[N][M], int B[M][N]);
+
+static double seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * check - Return 1 if every matrix of B is the transpose of the one in A
+ */
+static int check(int M, int N, long count, const int *A, const int *B)
+{
+    long k, size = (long)M * N;
+    int i, j;
+
+    for (k = 0; k < count; k++)
+        for (i = 0; i < N; i++)
+            for (j = 0; j < M; j++)
+                if (A[k * size + i * M + j] != B[k * size + j * N + i])
+                    return 0;
+    return 1;
+}
+
+/*
+ * time_loop - Best time of a loop calling func on each matrix. volatile
+ *     keeps the call indirect, as it is through trans_func_t.
+ */
+static double time_loop(trans_t func, int M, int N, long count, int *A, int *B)
+{
+    trans_t volatile call = func;
+    long k, size = (long)M * N;
+    double start, best = 0;
+    int run;
+
+    for (run = 0; run < TIME_RUNS; run++) {
+        start = seconds();
+        for (k = 0; k < count; k++)
+            call(M, N, (int (*)[M])(A + k * size), (int (*)[N])(B + k * size));
+        start = seconds() - start;
+        if (run == 0 || start < best)
+            best = start;
+    }
+    return best;
+}
+
+/*
+ * time_batch - Best time of one simdTransposeBatch call
+ */
+static double time_batch(int M, int N, long count, int *A, int *B)
+{
+    double start, best = 0;
+    int run;
+
+    for (run = 0; run < TIME_RUNS; run++) {
+        start = seconds();
+        simdTransposeBatch(M, N, count, A, B);
+        start = seconds() - start;
+        if (run == 0 || start < best)
+            best = start;
+    }
+    return best;
+}
+
+/*
+ * bench - Measure one shape. Returns 0, or -1 if a result was wrong.
+ */
+static int bench(int M, int N, long count)
+{
+    long k, size = (long)M * N;
+    double submit, simd, batch;
+    int *A, *B;
+
+    if (count <= 0)
+        count = BATCH_INTS / size > 0 ? BATCH_INTS / size : 1;
+    if ((A = malloc(count * size * sizeof(int))) == NULL ||
+        (B = malloc(count * size * sizeof(int))) == NULL) {
+        printf("%3dx%-3d skipped: out of memory\n", M, N);
+        free(A);
+        return 0;
+    }
+    for (k = 0; k < count * size; k++)
+        A[k] = (int)k;
+
+    /* B is cleared before each method so that each is checked on its own */
+    memset(B, 0, count * size * sizeof(int));
+    submit = time_loop(transpose_submit, M, N, count, A, B);
+    if (!check(M, N, count, A, B))
+        goto wrong;
+    memset(B, 0, count * size * sizeof(int));
+    simd = time_loop(simdTranspose, M, N, count, A, B);
+    if (!check(M, N, count, A, B))
+        goto wrong;
+    memset(B, 0, count * size * sizeof(int));
+    batch = time_batch(M, N, count, A, B);
+    if (!check(M, N, count, A, B))
+        goto wrong;
+
+    printf("%3dx%-3d %9ld %10.1f %10.1f %10.1f %8.2f %8.2f\n", M, N, count,
+           submit * 1e9 / count, simd * 1e9 / count, batch * 1e9 / count,
+           submit / simd, submit / batch);
+    fflush(stdout);
+    free(A);
+    free(B);
+    return 0;
+
+wrong:
+    printf("batchbench: wrong result for %dx%d\n", M, N);
+    free(A);
+    free(B);
+    return -1;
+}
+
+static void usage(char *argv[])
+{
+    printf("Usage: %s [-h] [-M <rows> -N <cols>] [-n <count>] [-i <isa>]\n", argv[0]);
+    printf("Options:\n");
+    printf("  -M <rows>   Rows of each matrix (default: a set of shapes)\n");
+    printf("  -N <cols>   Columns of each matrix\n");
+    printf("  -n <count>  Matrices in the batch (default: %d ints in all)\n", BATCH_INTS);
+    printf("  -i <isa>    Use at most this instruction set: scalar, sse2 or avx2\n");
+    printf("Example: %s -M 4 -N 4 -n 1000000\n", argv[0]);
+}
+
+int main(int argc, char *argv[])
+{
+    int M = 0, N = 0, level, i, status = 0;
+    long count = 0;
+    char c;
+
+    while ((c = getopt(argc, argv, "M:N:n:i:h")) != -1) {
+        switch (c) {
+        case 'M':
+            M = atoi(optarg);
+            break;
+        case 'N':
+            N = atoi(optarg);
+            break;
+        case 'n':
+            count = atol(optarg);
+            break;
+        case 'i':
+            if ((level = simdParseLevel(optarg)) < 0) {
+                printf("Error: unknown instruction set %s\n", optarg);
+                usage(argv);
+                exit(1);
+            }
+            simdLimitLevel(level);
+            break;
+        case 'h':
+            usage(argv);
+            exit(0);
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+    if (M < 0 || N < 0 || (M == 0) != (N == 0) || count < 0) {
+        usage(argv);
+        exit(1);
+    }
+
+    printf("SIMD level %s\n", simdLevelName(simdLevel()));
+    printf("%7s %9s %10s %10s %10s %8s %8s\n", "shape", "count", "submit ns",
+           "simd ns", "batch ns", "simd x", "batch x");
+    if (M > 0) {
+        status = bench(M, N, count);
+    } else {
+        for (i = 0; i < (int)(sizeof(default_shapes) / sizeof(default_shapes[0])); i++)
+            status |= bench(default_shapes[i][0], default_shapes[i][1], count);
+    }
+    return status ? 1 : 0;
+}
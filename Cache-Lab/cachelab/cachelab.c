@@ -6,10 +6,21 @@
 #include <assert.h>
 #include "cachelab.h"
 #include <time.h>
+#include <string.h>
 
 trans_func_t func_list[MAX_TRANS_FUNCS];
 int func_counter = 0; 
 
+/* The cache transpose functions target, see setTransCache */
+static int trans_s = 5, trans_E = 1, trans_b = 5;
+
+static const struct {
+    const char *name;
+    int size;
+} elem_types[NUM_ELEM_TYPES] = {
+    {"int8", 1}, {"int16", 2}, {"int32", 4}, {"float", 4}, {"double", 8}
+};
+
 /* 
  * printSummary - Summarize the cache simulation statistics. Student cache simulators
  *                must call this function in order to be properly autograded. 
@@ -73,11 +84,569 @@ void correctTrans(int M, int N, int A[N][M], int B[M][N])
 void registerTransFunction(void (*trans)(int M, int N, int[N][M], int[M][N]), 
                            char* desc)
 {
+    assert(func_counter < MAX_TRANS_FUNCS);
     func_list[func_counter].func_ptr = trans;
+    func_list[func_counter].array_func = NULL;
     func_list[func_counter].description = desc;
+    func_list[func_counter].cls = &trans_class;
+    func_list[func_counter].baseline = 0;
     func_list[func_counter].correct = 0;
     func_list[func_counter].num_hits = 0;
     func_list[func_counter].num_misses = 0;
     func_list[func_counter].num_evictions =0;
     func_counter++;
 }
+
+/* 
+ * registerInPlaceTransFunction - Add an in-place trans function, which
+ *     is called with the same arguments but leaves its result, an M x N
+ *     matrix, in the storage of A
+ */
+void registerInPlaceTransFunction(void (*trans)(int M, int N, int[N][M], int[M][N]), 
+                                  char* desc)
+{
+    registerTransFunction(trans, desc);
+    func_list[func_counter - 1].cls = &in_place_class;
+}
+
+/* 
+ * registerClassFunction - Add a function of a class other than the
+ *     int transposes, called with the arrays the class describes
+ */
+void registerClassFunction(const func_class_t *cls,
+                           void (*func)(int M, int N, void *arrays[]),
+                           char* desc, int baseline)
+{
+    registerTransFunction(NULL, desc);
+    func_list[func_counter - 1].array_func = func;
+    func_list[func_counter - 1].cls = cls;
+    func_list[func_counter - 1].baseline = baseline;
+}
+
+/* 
+ * findFunction - The index in func_list of the k-th registered function
+ *     of the given kind, or -1 if there are not that many
+ */
+int findFunction(int kind, int k)
+{
+    int i;
+    for (i = 0; i < func_counter; i++)
+        if (func_list[i].cls->kind == kind && k-- == 0)
+            return i;
+    return -1;
+}
+
+const func_class_t *findKernelClass(const char *name)
+{
+    int i;
+    for (i = 0; i < num_kernel_classes; i++)
+        if (strcmp(name, kernel_classes[i]->name) == 0)
+            return kernel_classes[i];
+    return NULL;
+}
+
+int elemSize(int elem)
+{
+    return elem_types[elem].size;
+}
+
+const char *elemName(int elem)
+{
+    return elem_types[elem].name;
+}
+
+int parseElem(const char *name)
+{
+    int elem;
+    for (elem = 0; elem < NUM_ELEM_TYPES; elem++)
+        if (strcmp(name, elem_types[elem].name) == 0)
+            return elem;
+    return -1;
+}
+
+/* 
+ * tileForElem - Derive a tile from the element width and the cache
+ */
+void tileForElem(int elem, int s, int E, int b, int *th, int *tw)
+{
+    int lines = E << s;
+
+    *tw = (1 << b) / elemSize(elem);
+    if (*tw < 1)
+        *tw = 1;
+    *th = *tw;
+    if (*th > lines / 2)
+        *th = lines / 2 > 0 ? lines / 2 : 1;
+}
+
+void setTransCache(int s, int E, int b)
+{
+    trans_s = s;
+    trans_E = E;
+    trans_b = b;
+}
+
+void getTransCache(int *s, int *E, int *b)
+{
+    *s = trans_s;
+    *E = trans_E;
+    *b = trans_b;
+}
+
+void tileForTarget(int elem, int *th, int *tw)
+{
+    tileForElem(elem, trans_s, trans_E, trans_b, th, tw);
+}
+
+/* 
+ * trans_len, trans_init, trans_check - B = A^T with A N x M ints
+ */
+static long trans_len(int array, int M, int N)
+{
+    (void)array;
+    return (long)M * N;
+}
+
+static void trans_init(int M, int N, void *arrays[])
+{
+    initMatrix(M, N, arrays[0], arrays[1]);
+}
+
+/* 
+ * check_transpose - Return -1 if T (M x N) is the transpose of A (N x M),
+ *     else the index in T of the first wrong element
+ */
+static long check_transpose(int M, int N, const int *A, const int *T)
+{
+    long i, j;
+
+    for (i = 0; i < N; i++)
+        for (j = 0; j < M; j++)
+            if (A[i * M + j] != T[j * N + i])
+                return j * N + i;
+    return -1;
+}
+
+static long trans_check(int M, int N, void *arrays[])
+{
+    return check_transpose(M, N, arrays[0], arrays[1]);
+}
+
+/* 
+ * in_place_init, in_place_check - As trans_*, but the result is left in
+ *     A; B, which an in-place function does not touch, keeps a copy of A
+ *     to check it against
+ */
+static void in_place_init(int M, int N, void *arrays[])
+{
+    initMatrix(M, N, arrays[0], arrays[1]);
+    memcpy(arrays[1], arrays[0], sizeof(int) * M * N);
+}
+
+static long in_place_check(int M, int N, void *arrays[])
+{
+    return check_transpose(M, N, arrays[1], arrays[0]);
+}
+
+const func_class_t trans_class = {
+    "int", FUNC_TRANS, ELEM_INT32, 2, {"A", "B"}, 1, trans_len, trans_init, trans_check
+};
+const func_class_t in_place_class = {
+    "in-place", FUNC_TRANS, ELEM_INT32, 2, {"A", "B"}, 0, trans_len, in_place_init, in_place_check
+};
+
+/* 
+ * typed_init - Random data of the given type. Floating point values
+ *     have fractions so that a transpose that converts through int fails.
+ */
+static void typed_init(int elem, int M, int N, void *A, void *B)
+{
+    long k, count = (long)M * N;
+
+    srand(time(NULL));
+    for (k = 0; k < count; k++) {
+        switch (elem) {
+        case ELEM_INT8:
+            ((signed char *)A)[k] = rand();
+            ((signed char *)B)[k] = rand();
+            break;
+        case ELEM_INT16:
+            ((short *)A)[k] = rand();
+            ((short *)B)[k] = rand();
+            break;
+        case ELEM_INT32:
+            ((int *)A)[k] = rand();
+            ((int *)B)[k] = rand();
+            break;
+        case ELEM_FLOAT:
+            ((float *)A)[k] = rand() / 7.0f;
+            ((float *)B)[k] = rand() / 7.0f;
+            break;
+        case ELEM_DOUBLE:
+            ((double *)A)[k] = rand() / 7.0;
+            ((double *)B)[k] = rand() / 7.0;
+            break;
+        }
+    }
+}
+
+/* 
+ * typed_check - Compare each element of A with its place in B
+ */
+static long typed_check(int elem, int M, int N, const void *A, const void *B)
+{
+    const char *a = A, *b = B;
+    int size = elemSize(elem);
+    long i, j;
+
+    for (i = 0; i < N; i++)
+        for (j = 0; j < M; j++)
+            if (memcmp(a + (i * M + j) * size, b + (j * N + i) * size, size) != 0)
+                return j * N + i;
+    return -1;
+}
+
+/* The class callbacks of one element type */
+#define TYPED_CLASS(name, elem) \
+static void typed_init_##name(int M, int N, void *arrays[]) \
+{ \
+    typed_init(elem, M, N, arrays[0], arrays[1]); \
+} \
+static long typed_check_##name(int M, int N, void *arrays[]) \
+{ \
+    return typed_check(elem, M, N, arrays[0], arrays[1]); \
+}
+
+TYPED_CLASS(int8, ELEM_INT8)
+TYPED_CLASS(int16, ELEM_INT16)
+TYPED_CLASS(int32, ELEM_INT32)
+TYPED_CLASS(float, ELEM_FLOAT)
+TYPED_CLASS(double, ELEM_DOUBLE)
+
+const func_class_t typed_classes[NUM_ELEM_TYPES] = {
+    {"int8", FUNC_TYPED, ELEM_INT8, 2, {"A", "B"}, 1,
+     trans_len, typed_init_int8, typed_check_int8},
+    {"int16", FUNC_TYPED, ELEM_INT16, 2, {"A", "B"}, 1,
+     trans_len, typed_init_int16, typed_check_int16},
+    {"int32", FUNC_TYPED, ELEM_INT32, 2, {"A", "B"}, 1,
+     trans_len, typed_init_int32, typed_check_int32},
+    {"float", FUNC_TYPED, ELEM_FLOAT, 2, {"A", "B"}, 1,
+     trans_len, typed_init_float, typed_check_float},
+    {"double", FUNC_TYPED, ELEM_DOUBLE, 2, {"A", "B"}, 1,
+     trans_len, typed_init_double, typed_check_double}
+};
+
+/* 
+ * fused_init - Random values in [-32768, 32767] for A and C, small
+ *     enough that alpha * A + C cannot overflow, and other data in B
+ */
+static void fused_init(int M, int N, void *arrays[])
+{
+    int *A = arrays[0], *B = arrays[1], *C = arrays[2];
+    long k, count = (long)M * N;
+
+    srand(time(NULL));
+    for (k = 0; k < count; k++) {
+        A[k] = rand() % 65536 - 32768;
+        C[k] = rand() % 65536 - 32768;
+        B[k] = rand();
+    }
+}
+
+/* 
+ * fused_check - Compute each element of B from A (and C) and compare
+ */
+static long fused_check(int op, int M, int N, void *arrays[])
+{
+    const int *A = arrays[0], *C = arrays[2];
+    const void *B = arrays[1];
+    long i, j;
+    int a;
+
+    for (i = 0; i < N; i++) {
+        for (j = 0; j < M; j++) {
+            a = A[i * M + j];
+            switch (op) {
+            case FUSED_SCALE:
+                if (((const int *)B)[j * N + i] != FUSED_ALPHA * a)
+                    return j * N + i;
+                break;
+            case FUSED_AXPY:
+                if (((const int *)B)[j * N + i] != FUSED_ALPHA * a + C[j * N + i])
+                    return j * N + i;
+                break;
+            case FUSED_TO_FLOAT:
+                if (((const float *)B)[j * N + i] != (float)a)
+                    return j * N + i;
+                break;
+            }
+        }
+    }
+    return -1;
+}
+
+static long fused_check_scale(int M, int N, void *arrays[])
+{
+    return fused_check(FUSED_SCALE, M, N, arrays);
+}
+
+static long fused_check_axpy(int M, int N, void *arrays[])
+{
+    return fused_check(FUSED_AXPY, M, N, arrays);
+}
+
+static long fused_check_to_float(int M, int N, void *arrays[])
+{
+    return fused_check(FUSED_TO_FLOAT, M, N, arrays);
+}
+
+const func_class_t fused_classes[NUM_FUSED_OPS] = {
+    {"scale", FUNC_FUSED, ELEM_INT32, 3, {"A", "B", "C"}, 1,
+     trans_len, fused_init, fused_check_scale},
+    {"axpy", FUNC_FUSED, ELEM_INT32, 3, {"A", "B", "C"}, 1,
+     trans_len, fused_init, fused_check_axpy},
+    {"to-float", FUNC_FUSED, ELEM_INT32, 3, {"A", "B", "C"}, 1,
+     trans_len, fused_init, fused_check_to_float}
+};
+
+/* 
+ * small_random - Fill an array with values in [-8, 7], small enough that
+ *     the sums the kernels form cannot overflow
+ */
+static void small_random(int *a, long len)
+{
+    long k;
+    for (k = 0; k < len; k++)
+        a[k] = rand() % 16 - 8;
+}
+
+/* 
+ * gemm_len, gemm_init, gemm_check - C = A B with A N x M, B M x N
+ */
+static long gemm_len(int array, int M, int N)
+{
+    return array == 2 ? (long)N * N : (long)M * N;
+}
+
+static void gemm_init(int M, int N, void *arrays[])
+{
+    srand(time(NULL));
+    small_random(arrays[0], (long)N * M);
+    small_random(arrays[1], (long)M * N);
+    small_random(arrays[2], (long)N * N);
+}
+
+static long gemm_check(int M, int N, void *arrays[])
+{
+    const int *A = arrays[0], *B = arrays[1], *C = arrays[2];
+    long i, j, k;
+    int sum;
+
+    for (i = 0; i < N; i++) {
+        for (j = 0; j < N; j++) {
+            for (sum = 0, k = 0; k < M; k++)
+                sum += A[i * M + k] * B[k * N + j];
+            if (C[i * N + j] != sum)
+                return i * N + j;
+        }
+    }
+    return -1;
+}
+
+/* 
+ * stencil_len, stencil_init, stencil_check - B[i][j] is the sum of A[i][j]
+ *     and its four neighbours inside the border and A[i][j] on it
+ */
+static long stencil_len(int array, int M, int N)
+{
+    (void)array;
+    return (long)M * N;
+}
+
+static void stencil_init(int M, int N, void *arrays[])
+{
+    srand(time(NULL));
+    small_random(arrays[0], (long)M * N);
+    small_random(arrays[1], (long)M * N);
+}
+
+static long stencil_check(int M, int N, void *arrays[])
+{
+    const int *A = arrays[0], *B = arrays[1];
+    long i, j;
+    int want;
+
+    for (i = 0; i < N; i++) {
+        for (j = 0; j < M; j++) {
+            want = A[i * M + j];
+            if (i > 0 && i < N - 1 && j > 0 && j < M - 1)
+                want += A[(i - 1) * M + j] + A[(i + 1) * M + j] +
+                        A[i * M + j - 1] + A[i * M + j + 1];
+            if (B[i * M + j] != want)
+                return i * M + j;
+        }
+    }
+    return -1;
+}
+
+/* 
+ * matvec_len, matvec_init, matvec_check - y = A x with A N x M
+ */
+static long matvec_len(int array, int M, int N)
+{
+    return array == 0 ? (long)M * N : array == 1 ? M : N;
+}
+
+static void matvec_init(int M, int N, void *arrays[])
+{
+    srand(time(NULL));
+    small_random(arrays[0], (long)M * N);
+    small_random(arrays[1], M);
+    small_random(arrays[2], N);
+}
+
+static long matvec_check(int M, int N, void *arrays[])
+{
+    const int *A = arrays[0], *x = arrays[1], *y = arrays[2];
+    long i, j;
+    int sum;
+
+    for (i = 0; i < N; i++) {
+        for (sum = 0, j = 0; j < M; j++)
+            sum += A[i * M + j] * x[j];
+        if (y[i] != sum)
+            return i;
+    }
+    return -1;
+}
+
+const func_class_t gemm_class = {
+    "gemm", FUNC_KERNEL, ELEM_INT32, 3, {"A", "B", "C"}, 2, gemm_len, gemm_init, gemm_check
+};
+const func_class_t stencil_class = {
+    "stencil", FUNC_KERNEL, ELEM_INT32, 2, {"A", "B"}, 1, stencil_len, stencil_init, stencil_check
+};
+const func_class_t matvec_class = {
+    "matvec", FUNC_KERNEL, ELEM_INT32, 3, {"A", "x", "y"}, 2, matvec_len, matvec_init, matvec_check
+};
+
+const func_class_t *kernel_classes[] = {&gemm_class, &stencil_class, &matvec_class};
+const int num_kernel_classes = sizeof(kernel_classes) / sizeof(kernel_classes[0]);
+
+/* 
+ * compareRanges - qsort comparator ordering ranges by base address
+ */
+static int compareRanges(const void *a, const void *b)
+{
+    const range_t *ra = a, *rb = b;
+    if (ra->base < rb->base)
+        return -1;
+    return ra->base > rb->base;
+}
+
+/* 
+ * addRange - Append one range, growing the array as needed
+ */
+int addRange(range_map_t *map, const char *name,
+             unsigned long long base, unsigned long long len)
+{
+    if (len == 0 || strlen(name) >= MAX_RANGE_NAME)
+        return -1;
+    if ((map->count & (map->count - 1)) == 0) {
+        /* count is zero or a power of two: double the capacity */
+        map->ranges = realloc(map->ranges,
+                              (map->count ? 2 * map->count : 1) * sizeof(range_t));
+        assert(map->ranges);
+    }
+    strcpy(map->ranges[map->count].name, name);
+    map->ranges[map->count].base = base;
+    map->ranges[map->count].len = len;
+    map->count++;
+    return 0;
+}
+
+/* 
+ * finishRangeMap - Sort the ranges by base so that findRange can use a
+ *     binary search, and reject overlapping ranges
+ */
+int finishRangeMap(range_map_t *map)
+{
+    int i;
+
+    qsort(map->ranges, map->count, sizeof(range_t), compareRanges);
+    for (i = 1; i < map->count; i++) {
+        if (map->ranges[i-1].base + map->ranges[i-1].len > map->ranges[i].base) {
+            fprintf(stderr, "Ranges %s and %s overlap\n",
+                    map->ranges[i-1].name, map->ranges[i].name);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* 
+ * loadRangeMap - Load a symbol/range map. Blank lines and lines starting
+ *     with '#' are ignored.
+ */
+int loadRangeMap(const char *filename, range_map_t *map)
+{
+    char line[256], name[MAX_RANGE_NAME];
+    unsigned long long base, len;
+    FILE *fp;
+
+    map->ranges = NULL;
+    map->count = 0;
+
+    if ((fp = fopen(filename, "r")) == NULL) {
+        fprintf(stderr, "Unable to open range map %s\n", filename);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+        if (sscanf(line, "%31s %llx %llu", name, &base, &len) != 3 ||
+            addRange(map, name, base, len) < 0) {
+            fprintf(stderr, "Malformed range in %s: %s", filename, line);
+            fclose(fp);
+            freeRangeMap(map);
+            return -1;
+        }
+    }
+    fclose(fp);
+
+    if (finishRangeMap(map) < 0) {
+        freeRangeMap(map);
+        return -1;
+    }
+    return 0;
+}
+
+/* 
+ * findRange - Binary search for the range holding addr
+ */
+int findRange(const range_map_t *map, unsigned long long addr)
+{
+    int lo = 0, hi = map->count - 1, mid;
+
+    while (lo <= hi) {
+        mid = (lo + hi) / 2;
+        if (addr < map->ranges[mid].base)
+            hi = mid - 1;
+        else if (addr - map->ranges[mid].base >= map->ranges[mid].len)
+            lo = mid + 1;
+        else
+            return mid;
+    }
+    return -1;
+}
+
+/* 
+ * freeRangeMap - Release a range map
+ */
+void freeRangeMap(range_map_t *map)
+{
+    free(map->ranges);
+    map->ranges = NULL;
+    map->count = 0;
+}
@@ -6,16 +6,99 @@
 #define CACHELAB_TOOLS_H
 
 #define MAX_TRANS_FUNCS 100
+#define MAX_RANGE_NAME 32
 
+/* Element types of the arrays a registered function works on */
+#define ELEM_INT8   0
+#define ELEM_INT16  1
+#define ELEM_INT32  2
+#define ELEM_FLOAT  3
+#define ELEM_DOUBLE 4
+#define NUM_ELEM_TYPES 5
+
+/* What a class of functions computes, which decides how they are called */
+#define FUNC_TRANS  0   /* func_ptr(M, N, A, B): the graded int transposes */
+#define FUNC_TYPED  1   /* array_func: B = A^T over the class's element type */
+#define FUNC_FUSED  2   /* array_func: a transpose fused with a pass over B */
+#define FUNC_KERNEL 3   /* array_func: another kernel, e.g. matrix multiply */
+
+/* What the fused transpose functions compute from A^T */
+#define FUSED_SCALE    0    /* B = alpha * A^T */
+#define FUSED_AXPY     1    /* B = alpha * A^T + C */
+#define FUSED_TO_FLOAT 2    /* B = (float)A^T, B an array of float */
+#define NUM_FUSED_OPS  3
+
+/* The alpha of FUSED_SCALE and FUSED_AXPY */
+#define FUSED_ALPHA 3
+
+/* Most arrays a function can work on */
+#define MAX_FUNC_ARRAYS 4
+
+/*
+ * A class of functions that compute the same thing, such as int8
+ * transposes or matrix multiplies. It names the arrays they take, says
+ * how long each is for an M x N problem and of what element type,
+ * fills them and checks the output, so that the harness can trace and
+ * validate any registered function without knowing what it computes.
+ */
+typedef struct func_class{
+  const char *name;
+  int kind;           /* FUNC_* */
+  int elem;           /* ELEM_* of the arrays, which sets their stride */
+  int num_arrays;
+  const char *array_names[MAX_FUNC_ARRAYS];
+  int output;         /* the array the functions write */
+  long (*array_len)(int array, int M, int N);   /* in elements */
+  void (*init)(int M, int N, void *arrays[]);
+  /* -1 if the output is right, else the index of a wrong element */
+  long (*check)(int M, int N, void *arrays[]);
+} func_class_t;
+
+/* One registered function. FUNC_TRANS ones are called through func_ptr
+   with A and B, the rest through array_func with the class's arrays. */
 typedef struct trans_func{
   void (*func_ptr)(int M,int N,int[N][M],int[M][N]);
+  void (*array_func)(int M, int N, void *arrays[]);
   char* description;
+  const func_class_t *cls;
+  char baseline;      /* what the others of its class are compared with */
   char correct;
   unsigned int num_hits;
   unsigned int num_misses;
   unsigned int num_evictions;
 } trans_func_t;
 
+/*
+ * The classes built into cachelab.c:
+ *   trans_class, in_place_class  B = A^T, A N x M and B M x N ints; an
+ *                                in-place function leaves A^T in A
+ *   typed_classes[ELEM_*]        B = A^T of that element type; the tile
+ *                                comes from tileForElem
+ *   fused_classes[FUSED_*]       B = op(A^T), C read by FUSED_AXPY
+ *   gemm     C = A B, A N x M, B M x N, C N x N
+ *   stencil  B = 5-point sum of A over the interior, A elsewhere; N x M
+ *   matvec   y = A x, A N x M, x of M and y of N ints
+ */
+extern const func_class_t trans_class, in_place_class;
+extern const func_class_t typed_classes[NUM_ELEM_TYPES];
+extern const func_class_t fused_classes[NUM_FUSED_OPS];
+extern const func_class_t gemm_class, stencil_class, matvec_class;
+extern const func_class_t *kernel_classes[];
+extern const int num_kernel_classes;
+
+/* A named region of the address space, e.g. one of the matrices */
+typedef struct range{
+  char name[MAX_RANGE_NAME];
+  unsigned long long base;
+  unsigned long long len;
+} range_t;
+
+/* A set of non-overlapping ranges, kept sorted by base address */
+typedef struct range_map{
+  range_t *ranges;
+  int count;
+} range_map_t;
+
 /*
  * printSummary - This function provides a standard way for your cache
  * simulator * to display its final hit and miss statistics
@@ -34,4 +117,67 @@ void correctTrans(int M, int N, int A[N][M], int B[M][N]);
 void registerTransFunction(
     void (*trans)(int M,int N,int[N][M],int[M][N]), char* desc);
 
+/* Add a function that leaves A^T in A's storage instead of in B */
+void registerInPlaceTransFunction(
+    void (*trans)(int M,int N,int[N][M],int[M][N]), char* desc);
+
+/* Add a function of any other class, e.g. a fused transpose or a
+   matrix multiply, to the function list. A baseline function, such as
+   a fused operation done in two passes, is the one the others of its
+   class are compared with. */
+void registerClassFunction(const func_class_t *cls,
+    void (*func)(int M, int N, void *arrays[]), char* desc, int baseline);
+
+/* The index in the function list of the k-th function of the given
+   kind (FUNC_*), or -1 */
+int findFunction(int kind, int k);
+
+/* The built-in kernel class with this name, or NULL */
+const func_class_t *findKernelClass(const char *name);
+
+/* Size in bytes, name ("int8", ..., "double") and lookup by name (-1 if unknown) */
+int elemSize(int elem);
+const char *elemName(int elem);
+int parseElem(const char *name);
+
+/*
+ * tileForElem - A tile is one cache block of elements wide, and as many
+ * rows high, but at most half the lines of the cache so that the rows
+ * of A and B it touches can all stay resident
+ */
+void tileForElem(int elem, int s, int E, int b, int *th, int *tw);
+
+/*
+ * setTransCache - Set the cache the transpose functions are tuned for
+ * and scored on: 2^s sets of E lines of 2^b bytes. Defaults to the
+ * graded s=5, E=1, b=5; test-trans and tracegen take it from -s/-E/-b.
+ */
+void setTransCache(int s, int E, int b);
+void getTransCache(int *s, int *E, int *b);
+
+/* The tile tileForElem gives elements of the given type on that cache */
+void tileForTarget(int elem, int *th, int *tw);
+
+/*
+ * loadRangeMap - Read "name base length" lines (base in hex) from the
+ * given file into map. Returns 0 on success, -1 on error.
+ */
+int loadRangeMap(const char *filename, range_map_t *map);
+
+/*
+ * addRange - Append a range to map. Call finishRangeMap once all have
+ * been added. Returns 0 on success, -1 on error.
+ */
+int addRange(range_map_t *map, const char *name,
+             unsigned long long base, unsigned long long len);
+
+/* Sort the ranges of map and reject overlaps. Returns 0 or -1 */
+int finishRangeMap(range_map_t *map);
+
+/* Return the index of the range containing addr, or -1 if none does */
+int findRange(const range_map_t *map, unsigned long long addr);
+
+/* Release the storage held by a range map */
+void freeRangeMap(range_map_t *map);
+
 #endif /* CACHELAB_TOOLS_H */
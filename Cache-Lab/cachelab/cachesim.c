@@ -0,0 +1,112 @@
+/*
+ * cachesim.c - Set-associative cache model
+ *
+ * Lines are stored set-major in one array. Each access advances the
+ * cache clock; LRU stamps a line on every use and FIFO only when it is
+ * filled, so the victim is always the valid line with the oldest stamp
+ * (or the first invalid line, if any).
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "cachesim.h"
+
+/* 
+ * cacheInit - Allocate and invalidate all lines 
+ */
+int cacheInit(cache_t *c, int s, int E, int b, int policy)
+{
+    if (s < 0 || s > 30 || E <= 0 || b < 0 || b > 63 || s + b > 63)
+        return -1;
+
+    c->s = s;
+    c->E = E;
+    c->b = b;
+    c->policy = policy;
+    c->clock = 0;
+    c->hits = c->misses = c->evictions = 0;
+    c->lines = calloc((size_t)E << s, sizeof(cache_line_t));
+    return c->lines ? 0 : -1;
+}
+
+/* 
+ * cacheFree - Release the lines 
+ */
+void cacheFree(cache_t *c)
+{
+    free(c->lines);
+    c->lines = NULL;
+}
+
+/* 
+ * cacheAccess - Simulate one access
+ */
+int cacheAccess(cache_t *c, uint64_t addr, int write, int owner,
+                cache_victim_t *victim)
+{
+    uint64_t set_index = (addr >> c->b) & ((1ULL << c->s) - 1);
+    uint64_t tag = addr >> (c->b + c->s);
+    cache_line_t *set = &c->lines[set_index * c->E];
+    cache_line_t *line = NULL;
+    int i, result;
+
+    c->clock++;
+
+    for (i = 0; i < c->E; i++) {
+        if (set[i].valid && set[i].tag == tag) {
+            if (c->policy == POLICY_LRU)
+                set[i].stamp = c->clock;
+            set[i].dirty |= write;
+            c->hits++;
+            return CACHE_HIT;
+        }
+    }
+
+    c->misses++;
+
+    /* Pick the first empty line, else the one with the oldest stamp */
+    for (i = 0; i < c->E; i++) {
+        if (!set[i].valid) {
+            line = &set[i];
+            break;
+        }
+        if (line == NULL || set[i].stamp < line->stamp)
+            line = &set[i];
+    }
+
+    result = 0;
+    if (line->valid) {
+        c->evictions++;
+        result = line->dirty ? CACHE_EVICTION | CACHE_WRITEBACK : CACHE_EVICTION;
+        if (victim) {
+            victim->addr = ((line->tag << c->s) | set_index) << c->b;
+            victim->owner = line->owner;
+        }
+    }
+
+    line->valid = 1;
+    line->dirty = write;
+    line->tag = tag;
+    line->owner = owner;
+    line->stamp = c->clock;
+    return result;
+}
+
+/* 
+ * parsePolicy - Policy name to constant 
+ */
+int parsePolicy(const char *name)
+{
+    if (strcmp(name, "lru") == 0)
+        return POLICY_LRU;
+    if (strcmp(name, "fifo") == 0)
+        return POLICY_FIFO;
+    return -1;
+}
+
+/* 
+ * policyName - Policy constant to name 
+ */
+const char *policyName(int policy)
+{
+    return policy == POLICY_FIFO ? "fifo" : "lru";
+}
@@ -0,0 +1,71 @@
+/*
+ * cachesim.h - Set-associative cache model shared by csim and the
+ *     transpose evaluation tools
+ */
+
+#ifndef CACHESIM_H
+#define CACHESIM_H
+
+#include <stdint.h>
+
+/* Replacement policies */
+#define POLICY_LRU  0
+#define POLICY_FIFO 1
+
+/* Result bits returned by cacheAccess */
+#define CACHE_HIT      0x1
+#define CACHE_EVICTION 0x2
+#define CACHE_WRITEBACK 0x4  /* the evicted line was dirty */
+
+typedef struct cache_line{
+  int valid;
+  int dirty;
+  int owner;          /* caller-supplied label of the access that filled it */
+  uint64_t tag;
+  uint64_t stamp;     /* last use (LRU) or fill time (FIFO) */
+} cache_line_t;
+
+/* What cacheAccess threw out to make room */
+typedef struct cache_victim{
+  uint64_t addr;      /* address of the first byte of the block */
+  int owner;
+} cache_victim_t;
+
+typedef struct cache{
+  int s, E, b;        /* 2^s sets of E lines holding 2^b byte blocks */
+  int policy;
+  uint64_t clock;     /* advances on every access */
+  cache_line_t *lines;/* (1 << s) * E lines, one set after another */
+  int hits;
+  int misses;
+  int evictions;
+} cache_t;
+
+/*
+ * cacheInit - Allocate an empty cache with the given geometry and
+ * replacement policy. Returns 0 on success, -1 on a bad geometry.
+ */
+int cacheInit(cache_t *c, int s, int E, int b, int policy);
+
+/* Release the lines of a cache */
+void cacheFree(cache_t *c);
+
+/*
+ * cacheAccess - Look up the block holding addr, filling it on a miss,
+ * and mark it dirty if write is set. The filled line is labelled with
+ * owner; if a valid line is evicted and victim is non-NULL, the
+ * block's address and label are stored there. Returns a combination
+ * of CACHE_HIT, CACHE_EVICTION and CACHE_WRITEBACK.
+ */
+int cacheAccess(cache_t *c, uint64_t addr, int write, int owner,
+                cache_victim_t *victim);
+
+/*
+ * parsePolicy - Map "lru" or "fifo" to a POLICY_ constant, or -1
+ */
+int parsePolicy(const char *name);
+
+/* Printable name of a POLICY_ constant */
+const char *policyName(int policy);
+
+#endif /* CACHESIM_H */
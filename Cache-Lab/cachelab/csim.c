@@ -1,3 +1,4 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -5,48 +6,153 @@
 #include <string.h>
 #include <errno.h>
 #include <stdint.h>
+#include <glob.h>
+#include <pthread.h>
 #include "cachelab.h"
+#include "cachesim.h"
+#include "dram.h"
 
 #define MAX_FILENAME_LEN 256
 #define MAX_LINE_LEN 1024
+#define DIFF_LOG_MAX 32 // diverging blocks listed without -v
 
-// Global variables
+// Geometry and policy of a cache given as "s,E,b[,policy]"
+typedef struct {
+    int s, E, b, policy;
+} cache_config;
+
+// Global configuration, fixed once the arguments are parsed
 int verbose = 0;
 int num_sets, num_sets_bits, set_size, block_size;
+int policy = POLICY_LRU;
 char trace_filename[MAX_FILENAME_LEN];
+char range_filename[MAX_FILENAME_LEN];
+
+// Per-range attribution, enabled with -r. Index range_map.count is the
+// catch-all for addresses outside every range.
+range_map_t range_map;
+
+// Differential simulation, enabled with -D
+int diff_enabled = 0;
+cache_config diff_config;
+
+// Instruction cache fed by 'I' records (-I) and a unified second level
+// shared by both first-level caches (-L)
+int icache_enabled = 0, l2_enabled = 0;
+cache_config icache_config, l2_config;
+
+// Memory controller behind the last cache level, enabled with -m
+int dram_enabled = 0;
+dram_config_t dram_config;
 
-int hits = 0, misses = 0, evictions = 0;
+// Batch mode (-B): traces simulated on a pool of -j worker threads
+int batch_enabled = 0;
+int num_workers = 0;
+char output_filename[MAX_FILENAME_LEN];
+char **batch_traces;
+int batch_count, batch_capacity;
 
 // Struct definitions
 typedef struct {
-    int valid;
-    uint64_t tag;
-    int timestamp;
-} cache_line;
+    int hits, misses, evictions;
+} range_stats;
 
 typedef struct {
-    cache_line *lines;
-} cache_set;
+    uint64_t block;     // address >> min(b, diff_config.b), 0 marks an empty slot
+    long primary_only;  // hit in the primary cache, missed in the other
+    long diff_only;     // missed in the primary cache, hit in the other
+    uint64_t first;     // index of the first diverging access
+} diff_entry;
 
+// Everything one simulation of one trace updates. Each trace in batch
+// mode gets its own, so workers share nothing but the configuration.
 typedef struct {
-    cache_set *sets;
-} cache;
+    cache_t l1d;
+    cache_t l1i;
+    cache_t l2;
+    cache_t diff;
+    dram_t dram;
 
-// Global cache variable
-cache sim_cache;
+    range_stats *per_range;
+    int *eviction_matrix; // [evictor][victim], (count + 1) x (count + 1)
+
+    // outcome[p][d] counts lookups that hit (1) or missed (0) in each cache
+    long outcome[2][2];
+    diff_entry *diff_table;
+    uint64_t diff_capacity, diff_used;
+    uint64_t access_index;
+} simulator;
 
 // Function to print usage and exit
 void print_usage_and_exit() {
-    fprintf(stderr, "Usage: ./csim [-v] -s <s> -E <E> -b <b> -t <tracefile>\n");
+    fprintf(stderr, "Usage: ./csim [-v] -s <s> -E <E> -b <b> -t <tracefile> [-p <policy>]\n"
+                    "              [-r <rangefile>] [-D <s>,<E>,<b>[,<policy>]]\n"
+                    "              [-m <channels>,<banks>,<rows>[,open|closed]]\n"
+                    "              [-I <s>,<E>,<b>[,<policy>]] [-L <s>,<E>,<b>[,<policy>]]\n"
+                    "       ./csim -s <s> -E <E> -b <b> -B <glob|@listfile> [-B ...]\n"
+                    "              [-j <threads>] [-o <csvfile>] [cache options] [tracefile ...]\n");
     exit(EXIT_FAILURE);
 }
 
+// Function to parse a cache configuration given to -D, -I or -L
+void parse_cache_config(int opt, char *spec, cache_config *cfg) {
+    char name[8] = "lru";
+    int n = sscanf(spec, "%d,%d,%d,%7s", &cfg->s, &cfg->E, &cfg->b, name);
+
+    cfg->policy = parsePolicy(name);
+    if (n < 3 || cfg->s <= 0 || cfg->E <= 0 || cfg->b <= 0 || cfg->policy < 0) {
+        fprintf(stderr, "Invalid value for -%c: %s\n", opt, spec);
+        print_usage_and_exit();
+    }
+}
+
+// Function to append one trace to the batch
+void add_batch_trace(const char *path) {
+    if (batch_count == batch_capacity) {
+        batch_capacity = batch_capacity ? batch_capacity * 2 : 64;
+        batch_traces = (char **)realloc(batch_traces, batch_capacity * sizeof(char *));
+    }
+    batch_traces[batch_count++] = strdup(path);
+}
+
+// Function to add the traces named by a -B argument: either a glob
+// pattern or "@file" with one trace path per line
+void add_batch_spec(const char *spec) {
+    if (spec[0] == '@') {
+        char line[MAX_LINE_LEN];
+        FILE *list = fopen(spec + 1, "r");
+
+        if (list == NULL) {
+            perror("Error opening trace list");
+            exit(EXIT_FAILURE);
+        }
+        while (fgets(line, MAX_LINE_LEN, list) != NULL) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (line[0] != '\0' && line[0] != '#') {
+                add_batch_trace(line);
+            }
+        }
+        fclose(list);
+        return;
+    }
+
+    glob_t matches;
+    if (glob(spec, GLOB_NOCHECK, NULL, &matches) != 0) {
+        fprintf(stderr, "Invalid value for -B: %s\n", spec);
+        print_usage_and_exit();
+    }
+    for (size_t i = 0; i < matches.gl_pathc; i++) {
+        add_batch_trace(matches.gl_pathv[i]);
+    }
+    globfree(&matches);
+}
+
 // Function to parse and validate arguments
 void parse_arguments(int argc, char *argv[]) {
     int opt;
     char *endptr;
 
-    while ((opt = getopt(argc, argv, "vs:E:b:t:")) != -1) {
+    while ((opt = getopt(argc, argv, "vs:E:b:t:r:p:D:m:I:L:B:j:o:")) != -1) {
         switch (opt) {
             case 'v':
                 verbose = 1;
@@ -77,93 +183,348 @@ void parse_arguments(int argc, char *argv[]) {
                 strncpy(trace_filename, optarg, MAX_FILENAME_LEN);
                 trace_filename[MAX_FILENAME_LEN - 1] = '\0';
                 break;
+            case 'r':
+                strncpy(range_filename, optarg, MAX_FILENAME_LEN);
+                range_filename[MAX_FILENAME_LEN - 1] = '\0';
+                break;
+            case 'p':
+                if ((policy = parsePolicy(optarg)) < 0) {
+                    fprintf(stderr, "Invalid value for -p: %s\n", optarg);
+                    print_usage_and_exit();
+                }
+                break;
+            case 'D':
+                parse_cache_config(opt, optarg, &diff_config);
+                diff_enabled = 1;
+                break;
+            case 'm':
+                if (parseDramConfig(optarg, &dram_config) < 0) {
+                    fprintf(stderr, "Invalid value for -m: %s\n", optarg);
+                    print_usage_and_exit();
+                }
+                dram_enabled = 1;
+                break;
+            case 'I':
+                parse_cache_config(opt, optarg, &icache_config);
+                icache_enabled = 1;
+                break;
+            case 'L':
+                parse_cache_config(opt, optarg, &l2_config);
+                l2_enabled = 1;
+                break;
+            case 'B':
+                add_batch_spec(optarg);
+                batch_enabled = 1;
+                break;
+            case 'j':
+                num_workers = strtol(optarg, &endptr, 10);
+                if (*endptr != '\0' || num_workers <= 0) {
+                    fprintf(stderr, "Invalid value for -j: %s\n", optarg);
+                    print_usage_and_exit();
+                }
+                break;
+            case 'o':
+                strncpy(output_filename, optarg, MAX_FILENAME_LEN);
+                output_filename[MAX_FILENAME_LEN - 1] = '\0';
+                break;
             default:
                 print_usage_and_exit();
         }
     }
 
+    // Any remaining arguments are extra batch traces
+    for (int i = optind; i < argc; i++) {
+        add_batch_trace(argv[i]);
+        batch_enabled = 1;
+    }
+
     // Check if all required arguments are provided
-    if (num_sets == 0 || set_size == 0 || block_size == 0 || trace_filename[0] == '\0') {
+    if (num_sets == 0 || set_size == 0 || block_size == 0 ||
+        (trace_filename[0] == '\0' && !batch_enabled)) {
         fprintf(stderr, "Missing required arguments\n");
         print_usage_and_exit();
     }
+
+    if (batch_enabled) {
+        if (trace_filename[0] != '\0') {
+            add_batch_trace(trace_filename);
+        }
+        // Per-access and per-block reports do not fit in one row per trace
+        if (verbose || diff_enabled || range_filename[0] != '\0') {
+            fprintf(stderr, "-v, -D and -r cannot be combined with batch mode\n");
+            print_usage_and_exit();
+        }
+    }
 }
 
-// Function to initialize the cache
-void init_cache() {
-    sim_cache.sets = (cache_set *)malloc(num_sets * sizeof(cache_set));
-    for (int i = 0; i < num_sets; i++) {
-        sim_cache.sets[i].lines = (cache_line *)malloc(set_size * sizeof(cache_line));
-        for (int j = 0; j < set_size; j++) {
-            sim_cache.sets[i].lines[j].valid = 0;
-            sim_cache.sets[i].lines[j].tag = 0;
-            sim_cache.sets[i].lines[j].timestamp = 0;
+// Function to allocate a cache from a parsed configuration
+void init_configured_cache(int opt, cache_t *c, cache_config *cfg) {
+    if (cacheInit(c, cfg->s, cfg->E, cfg->b, cfg->policy) < 0) {
+        fprintf(stderr, "Unsupported cache geometry for -%c\n", opt);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Function to initialize the caches and counters of a simulator
+void init_simulator(simulator *sim) {
+    memset(sim, 0, sizeof(*sim));
+
+    if (cacheInit(&sim->l1d, num_sets_bits, set_size, block_size, policy) < 0) {
+        fprintf(stderr, "Unsupported cache geometry\n");
+        exit(EXIT_FAILURE);
+    }
+    if (diff_enabled) {
+        init_configured_cache('D', &sim->diff, &diff_config);
+        sim->diff_capacity = 1024;
+        sim->diff_table = (diff_entry *)calloc(sim->diff_capacity, sizeof(diff_entry));
+    }
+    if (icache_enabled) {
+        init_configured_cache('I', &sim->l1i, &icache_config);
+    }
+    if (l2_enabled) {
+        init_configured_cache('L', &sim->l2, &l2_config);
+    }
+    if (dram_enabled && dramInit(&sim->dram, &dram_config) < 0) {
+        fprintf(stderr, "Unable to allocate the DRAM model\n");
+        exit(EXIT_FAILURE);
+    }
+    if (range_filename[0] != '\0') {
+        int n = range_map.count + 1;
+        sim->per_range = (range_stats *)calloc(n, sizeof(range_stats));
+        sim->eviction_matrix = (int *)calloc(n * n, sizeof(int));
+    }
+}
+
+// Function to free everything a simulator allocated
+void free_simulator(simulator *sim) {
+    cacheFree(&sim->l1d);
+    if (diff_enabled) {
+        cacheFree(&sim->diff);
+        free(sim->diff_table);
+    }
+    if (icache_enabled) {
+        cacheFree(&sim->l1i);
+    }
+    if (l2_enabled) {
+        cacheFree(&sim->l2);
+    }
+    if (dram_enabled) {
+        dramFree(&sim->dram);
+    }
+    free(sim->per_range);
+    free(sim->eviction_matrix);
+}
+
+// Function to print the per-range breakdown and the eviction matrix
+void print_ranges(simulator *sim) {
+    int n = range_map.count + 1;
+
+    printf("%-16s %10s %10s %10s\n", "range", "hits", "misses", "evictions");
+    for (int i = 0; i < n; i++) {
+        printf("%-16s %10d %10d %10d\n",
+               i < range_map.count ? range_map.ranges[i].name : "<other>",
+               sim->per_range[i].hits, sim->per_range[i].misses,
+               sim->per_range[i].evictions);
+    }
+
+    printf("\nEviction matrix (row evicted column):\n%-16s", "");
+    for (int j = 0; j < n; j++) {
+        printf(" %10s", j < range_map.count ? range_map.ranges[j].name : "<other>");
+    }
+    printf("\n");
+    for (int i = 0; i < n; i++) {
+        printf("%-16s", i < range_map.count ? range_map.ranges[i].name : "<other>");
+        for (int j = 0; j < n; j++) {
+            printf(" %10d", sim->eviction_matrix[i * n + j]);
         }
+        printf("\n");
     }
 }
 
-// Function to free the cache
-void free_cache() {
-    for (int i = 0; i < num_sets; i++) {
-        free(sim_cache.sets[i].lines);
+// Function to find (or create) the divergence record for a block.
+// The table is open-addressed and doubles when it is half full.
+diff_entry *diff_lookup(simulator *sim, uint64_t block) {
+    if (2 * (sim->diff_used + 1) > sim->diff_capacity) {
+        diff_entry *old = sim->diff_table;
+        uint64_t old_capacity = sim->diff_capacity;
+
+        sim->diff_capacity *= 2;
+        sim->diff_table = (diff_entry *)calloc(sim->diff_capacity, sizeof(diff_entry));
+        for (uint64_t i = 0; i < old_capacity; i++) {
+            if (old[i].block) {
+                uint64_t j = (old[i].block * 0x9e3779b97f4a7c15ULL) & (sim->diff_capacity - 1);
+                while (sim->diff_table[j].block) {
+                    j = (j + 1) & (sim->diff_capacity - 1);
+                }
+                sim->diff_table[j] = old[i];
+            }
+        }
+        free(old);
+    }
+
+    uint64_t j = (block * 0x9e3779b97f4a7c15ULL) & (sim->diff_capacity - 1);
+    while (sim->diff_table[j].block && sim->diff_table[j].block != block) {
+        j = (j + 1) & (sim->diff_capacity - 1);
     }
-    free(sim_cache.sets);
+    if (!sim->diff_table[j].block) {
+        sim->diff_table[j].block = block;
+        sim->diff_table[j].first = sim->access_index;
+        sim->diff_used++;
+    }
+    return &sim->diff_table[j];
 }
 
-// Function to check the cache for a given address and operation
-void check_cache(char operation, uint64_t address) {
-    int set_index = (address >> block_size) & (num_sets - 1);
-    uint64_t tag = address >> (block_size + num_sets_bits);
-    cache_set *set = &sim_cache.sets[set_index];
-    int hit = 0;
-    int eviction = 0;
-
-    // Check for a hit
-    for (int i = 0; i < set_size; i++) {
-        if (set->lines[i].valid && set->lines[i].tag == tag) {
-            hit = 1;
-            hits++;
-            set->lines[i].timestamp = 0; // Reset timestamp for LRU
+// Function to record the outcome of one lookup in both caches
+void record_diff(simulator *sim, uint64_t address, int primary_hit, int diff_hit) {
+    sim->outcome[primary_hit][diff_hit]++;
+    if (primary_hit != diff_hit) {
+        int shift = block_size < diff_config.b ? block_size : diff_config.b;
+        // Offset by one so that block 0 does not look like an empty slot
+        diff_entry *e = diff_lookup(sim, (address >> shift) + 1);
+        if (primary_hit) {
+            e->primary_only++;
+        } else {
+            e->diff_only++;
+        }
+    }
+}
+
+// Function to order divergence records, most diverging blocks first
+int compare_diff(const void *a, const void *b) {
+    const diff_entry *x = a, *y = b;
+    long dx = x->primary_only + x->diff_only;
+    long dy = y->primary_only + y->diff_only;
+    if (dx != dy) {
+        return dx < dy ? 1 : -1;
+    }
+    return x->first < y->first ? -1 : x->first > y->first;
+}
+
+// Function to print the outcome matrix and the diverging blocks
+void print_diff(simulator *sim) {
+    int shift = block_size < diff_config.b ? block_size : diff_config.b;
+    diff_entry *table = sim->diff_table;
+    uint64_t n = 0;
+
+    printf("\nDifferential simulation: P=(s=%d,E=%d,b=%d,%s) D=(s=%d,E=%d,b=%d,%s)\n",
+           num_sets_bits, set_size, block_size, policyName(policy),
+           diff_config.s, diff_config.E, diff_config.b, policyName(diff_config.policy));
+    printf("D hits:%d misses:%d evictions:%d\n",
+           sim->diff.hits, sim->diff.misses, sim->diff.evictions);
+    printf("%-8s %12s %12s\n", "", "D hit", "D miss");
+    printf("%-8s %12ld %12ld\n", "P hit", sim->outcome[1][1], sim->outcome[1][0]);
+    printf("%-8s %12ld %12ld\n", "P miss", sim->outcome[0][1], sim->outcome[0][0]);
+
+    // Compact the table in place and sort it
+    for (uint64_t i = 0; i < sim->diff_capacity; i++) {
+        if (table[i].block) {
+            table[n++] = table[i];
+        }
+    }
+    qsort(table, n, sizeof(diff_entry), compare_diff);
+
+    printf("\nDiverging blocks (%lu, %d-byte granularity):\n", n, 1 << shift);
+    printf("%-18s %12s %12s %12s\n", "block", "P hit/D miss", "P miss/D hit", "first");
+    for (uint64_t i = 0; i < n; i++) {
+        if (!verbose && i == DIFF_LOG_MAX) {
+            printf("... %lu more (use -v to list all)\n", n - i);
             break;
         }
+        printf("0x%-16lx %12ld %12ld %12lu\n", (table[i].block - 1) << shift,
+               table[i].primary_only, table[i].diff_only, table[i].first);
     }
+}
 
-    if (!hit) {
-        misses++;
-        // Find an empty line or the least recently used line
-        int lru_index = -1;
-        int max_timestamp = 0;
-        for (int i = 0; i < set_size; i++) {
-            if (!set->lines[i].valid) {
-                lru_index = i;
-                break;
-            }
-            if (set->lines[i].timestamp >= max_timestamp) {
-                lru_index = i;
-                max_timestamp = set->lines[i].timestamp;
-            }
+// Function to send a block read or write-back to the level below the
+// first-level caches: the unified L2 if there is one, else memory
+void access_next_level(simulator *sim, uint64_t address, int write) {
+    if (l2_enabled) {
+        cache_victim_t victim;
+        int result = cacheAccess(&sim->l2, address, write, 0, &victim);
+
+        if (!dram_enabled || (result & CACHE_HIT)) {
+            return;
+        }
+        if (result & CACHE_WRITEBACK) {
+            dramAccess(&sim->dram, victim.addr, 1);
         }
+        // A write-back overwrites the whole block, so only reads fetch it
+        if (!write) {
+            dramAccess(&sim->dram, address & ~((1ULL << sim->l2.b) - 1), 0);
+        }
+        return;
+    }
+    if (dram_enabled) {
+        dramAccess(&sim->dram, address, write);
+    }
+}
+
+// Function to fetch an instruction through the instruction cache
+void check_icache(simulator *sim, uint64_t address) {
+    int result = cacheAccess(&sim->l1i, address, 0, 0, NULL);
+
+    if (!(result & CACHE_HIT) && (l2_enabled || dram_enabled)) {
+        access_next_level(sim, address & ~((1ULL << sim->l1i.b) - 1), 0);
+    }
+
+    if (verbose) {
+        printf("I %lx %s%s\n", address,
+               (result & CACHE_HIT) ? "hit" : "miss",
+               (result & CACHE_EVICTION) ? " eviction" : "");
+    }
+}
+
+// Function to check the cache for a given address and operation
+void check_cache(simulator *sim, char operation, uint64_t address) {
+    int range = 0;
+    int write = operation == 'S' || operation == 'M';
+    cache_victim_t victim;
+    range_stats *rs = NULL;
 
-        if (set->lines[lru_index].valid) {
-            evictions++;
-            eviction = 1;
+    if (sim->per_range) {
+        range = findRange(&range_map, address);
+        if (range < 0) {
+            range = range_map.count;
         }
+        rs = &sim->per_range[range];
+    }
+
+    int result = cacheAccess(&sim->l1d, address, write, range, &victim);
+    int hit = result & CACHE_HIT;
+    int eviction = result & CACHE_EVICTION;
 
-        // Update the cache line
-        set->lines[lru_index].valid = 1;
-        set->lines[lru_index].tag = tag;
-        set->lines[lru_index].timestamp = 0; // Reset timestamp for LRU
+    if (rs) {
+        if (hit) {
+            rs->hits++;
+        } else {
+            rs->misses++;
+        }
+        if (eviction) {
+            rs->evictions++;
+            sim->eviction_matrix[range * (range_map.count + 1) + victim.owner]++;
+        }
     }
 
-    // Update timestamps for LRU
-    for (int i = 0; i < set_size; i++) {
-        if (set->lines[i].valid) {
-            set->lines[i].timestamp++;
+    // Misses fetch the block from below; dirty victims are written back
+    if (!hit && (l2_enabled || dram_enabled)) {
+        if (result & CACHE_WRITEBACK) {
+            access_next_level(sim, victim.addr, 1);
         }
+        access_next_level(sim, address & ~((1ULL << block_size) - 1), 0);
+    }
+
+    if (diff_enabled) {
+        int diff_hit = cacheAccess(&sim->diff, address, write, 0, NULL) & CACHE_HIT;
+        record_diff(sim, address, hit != 0, diff_hit != 0);
     }
 
     if (operation == 'M') {
-        hits++; // Modify operation results in an additional hit
+        sim->l1d.hits++; // Modify operation results in an additional hit
+        if (rs) rs->hits++;
+        if (diff_enabled) {
+            sim->diff.hits++;
+            sim->outcome[1][1]++;
+        }
     }
 
     // Log the result if verbose mode is enabled
@@ -172,20 +533,15 @@ void check_cache(char operation, uint64_t address) {
                hit ? "hit" : "miss",
                eviction ? " eviction" : "");
     }
+    sim->access_index++;
 }
 
-int main(int argc, char *argv[]) {
-    // Parse and validate arguments
-    parse_arguments(argc, argv);
-
-    // Initialize the cache
-    init_cache();
-
-    // Open the trace file
-    FILE *trace_file = fopen(trace_filename, "r");
+// Function to run every record of a trace through a simulator.
+// Returns 0 on success, -1 if the trace cannot be opened.
+int simulate_trace(simulator *sim, const char *filename) {
+    FILE *trace_file = fopen(filename, "r");
     if (trace_file == NULL) {
-        perror("Error opening trace file");
-        exit(EXIT_FAILURE);
+        return -1;
     }
 
     // Parse each line in the trace file
@@ -197,21 +553,186 @@ int main(int argc, char *argv[]) {
     while (fgets(line, MAX_LINE_LEN, trace_file) != NULL) {
         if (sscanf(line, " %c %lx,%d", &operation, &address, &size) == 3) {
             if (operation == 'I') {
-                continue; // Skip instruction cache accesses
+                if (icache_enabled) {
+                    check_icache(sim, address);
+                }
+                continue; // Instruction fetches never touch the data cache
             }
 
             // Check the cache for the given address and operation
-            check_cache(operation, address);
+            check_cache(sim, operation, address);
         }
     }
 
     // Close the trace file
     fclose(trace_file);
+    return 0;
+}
 
-    // Free the cache memory
-    free_cache();
+// Batch jobs are handed out in order through a shared cursor. Results
+// keep copies of the simulator's caches for their counters only.
+typedef struct {
+    int status; // 0 once simulated, -1 if the trace could not be read
+    cache_t l1d, l1i, l2;
+    dram_t dram;
+} batch_result;
+
+batch_result *batch_results;
+int batch_next = 0;
+pthread_mutex_t batch_lock = PTHREAD_MUTEX_INITIALIZER;
 
-    printSummary(hits, misses, evictions);
+// Function run by each worker: simulate traces until none are left
+void *batch_worker(void *arg) {
+    (void)arg;
+    for (;;) {
+        pthread_mutex_lock(&batch_lock);
+        int i = batch_next++;
+        pthread_mutex_unlock(&batch_lock);
+        if (i >= batch_count) {
+            return NULL;
+        }
+
+        simulator sim;
+        init_simulator(&sim);
+        batch_results[i].status = simulate_trace(&sim, batch_traces[i]);
+        batch_results[i].l1d = sim.l1d;
+        batch_results[i].l1i = sim.l1i;
+        batch_results[i].l2 = sim.l2;
+        batch_results[i].dram = sim.dram;
+        free_simulator(&sim);
+    }
+}
+
+// Function to write one CSV row per trace, in the order given
+void print_batch(FILE *out) {
+    fprintf(out, "trace,status,hits,misses,evictions");
+    if (icache_enabled) {
+        fprintf(out, ",i_hits,i_misses,i_evictions");
+    }
+    if (l2_enabled) {
+        fprintf(out, ",l2_hits,l2_misses,l2_evictions");
+    }
+    if (dram_enabled) {
+        fprintf(out, ",dram_reads,dram_writes,row_hits,row_empty,row_conflicts,dram_cycles");
+    }
+    fprintf(out, "\n");
+
+    for (int i = 0; i < batch_count; i++) {
+        batch_result *r = &batch_results[i];
+        fprintf(out, "%s,%s,%d,%d,%d", batch_traces[i], r->status ? "error" : "ok",
+                r->l1d.hits, r->l1d.misses, r->l1d.evictions);
+        if (icache_enabled) {
+            fprintf(out, ",%d,%d,%d", r->l1i.hits, r->l1i.misses, r->l1i.evictions);
+        }
+        if (l2_enabled) {
+            fprintf(out, ",%d,%d,%d", r->l2.hits, r->l2.misses, r->l2.evictions);
+        }
+        if (dram_enabled) {
+            fprintf(out, ",%ld,%ld,%ld,%ld,%ld,%lu", r->dram.reads, r->dram.writes,
+                    r->dram.row_hits, r->dram.row_empty, r->dram.row_conflicts,
+                    (unsigned long)r->dram.cycles);
+        }
+        fprintf(out, "\n");
+    }
+}
+
+// Function to simulate all batch traces concurrently. Results go to one
+// CSV file (or stdout) instead of the shared .csim_results file.
+int run_batch() {
+    int failed = 0;
+
+    if (num_workers == 0) {
+        num_workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (num_workers > batch_count) {
+        num_workers = batch_count > 0 ? batch_count : 1;
+    }
+
+    batch_results = (batch_result *)calloc(batch_count + 1, sizeof(batch_result));
+    pthread_t *workers = (pthread_t *)malloc(num_workers * sizeof(pthread_t));
+    for (int i = 0; i < num_workers; i++) {
+        if (pthread_create(&workers[i], NULL, batch_worker, NULL) != 0) {
+            fprintf(stderr, "Unable to start worker thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int i = 0; i < num_workers; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+
+    FILE *out = stdout;
+    if (output_filename[0] != '\0' && (out = fopen(output_filename, "w")) == NULL) {
+        perror("Error opening output file");
+        exit(EXIT_FAILURE);
+    }
+    print_batch(out);
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    for (int i = 0; i < batch_count; i++) {
+        if (batch_results[i].status) {
+            fprintf(stderr, "Error reading trace file %s\n", batch_traces[i]);
+            failed = 1;
+        }
+        free(batch_traces[i]);
+    }
+    free(batch_traces);
+    free(batch_results);
+    return failed ? EXIT_FAILURE : 0;
+}
+
+int main(int argc, char *argv[]) {
+    simulator sim;
+
+    // Parse and validate arguments
+    parse_arguments(argc, argv);
+
+    // Load the optional range map for per-range attribution
+    if (range_filename[0] != '\0' && loadRangeMap(range_filename, &range_map) < 0) {
+        exit(EXIT_FAILURE);
+    }
+
+    if (batch_enabled) {
+        return run_batch();
+    }
+
+    // Initialize the cache(s)
+    init_simulator(&sim);
+
+    if (simulate_trace(&sim, trace_filename) < 0) {
+        perror("Error opening trace file");
+        exit(EXIT_FAILURE);
+    }
+
+    printSummary(sim.l1d.hits, sim.l1d.misses, sim.l1d.evictions);
+
+    if (sim.per_range) {
+        print_ranges(&sim);
+    }
+
+    if (icache_enabled) {
+        printf("I-cache hits:%d misses:%d evictions:%d\n",
+               sim.l1i.hits, sim.l1i.misses, sim.l1i.evictions);
+    }
+
+    if (l2_enabled) {
+        printf("L2 hits:%d misses:%d evictions:%d\n",
+               sim.l2.hits, sim.l2.misses, sim.l2.evictions);
+    }
+
+    if (dram_enabled) {
+        dramPrintStats(&sim.dram);
+    }
+
+    if (diff_enabled) {
+        print_diff(&sim);
+    }
+
+    // Free the cache memory
+    free_simulator(&sim);
+    freeRangeMap(&range_map);
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,247 @@
+/*
+ * csimbench.c - Measures the speed of csim and checks its miss counts
+ *     against closed-form expectations.
+ *
+ * Each benchmark case generates a synthetic trace with ./patgen and
+ * then runs ./csim over it at several (s, E, b) settings, reporting
+ * accesses per second and the peak resident set size of the csim
+ * process. Where the pattern has an exactly known outcome the hit,
+ * miss and eviction counts are checked as well:
+ *
+ *   - Sweeps (seq, stride) touch the same ordered list of blocks on
+ *     every pass. A set that receives m <= E of those blocks misses m
+ *     times in total; a set that receives more thrashes under LRU and
+ *     misses m times on every pass, evicting all but its first E fills.
+ *   - Any pattern whose whole footprint fits (m <= E in every set)
+ *     misses exactly once per distinct block it touches.
+ */
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define BENCH_TRACE "bench.trace"
+#define BASE 0x10000000ULL
+
+/* A benchmark case: a patgen invocation and what it produces */
+typedef struct {
+    char *pattern;
+    long n, w, k, footprint, passes, tile;
+    long accesses;          /* records in the generated trace */
+} bench_case;
+
+static bench_case cases[] = {
+    /* pattern     n       w    k     footprint  passes tile accesses */
+    {"seq",        1<<20,  4,   0,    0,         1,     0,   1<<20},
+    {"seq",        1<<12,  4,   0,    0,         256,   0,   1<<20},
+    {"stride",     1<<12,  4,   4096, 0,         256,   0,   1<<20},
+    {"uniform",    1<<20,  4,   0,    1<<22,     1,     0,   1<<20},
+    {"uniform",    1<<20,  8,   0,    1<<10,     1,     0,   1<<20},
+    {"zipf",       1<<20,  4,   0,    1<<22,     1,     0,   1<<20},
+    {"chase",      1<<20,  64,  0,    1<<24,     1,     0,   1<<20},
+    {"chase",      1<<20,  64,  0,    1<<10,     1,     0,   1<<20},
+    {"blocked",    256,    4,   0,    0,         8,     8,   1<<20},
+};
+
+/* Cache geometries every case is simulated on */
+static int geometries[][3] = {
+    {5, 1, 5},   /* the 1KB direct-mapped cache used by test-trans */
+    {2, 4, 3},
+    {6, 8, 6},   /* 32KB, 8-way, 64-byte lines */
+    {10, 16, 6}, /* 1MB, 16-way, 64-byte lines */
+};
+
+typedef struct {
+    long hits, misses, evictions;
+} counts;
+
+/*
+ * add_blocks - Count, per set, the distinct blocks touched by count
+ *     accesses step bytes apart from start
+ */
+static void add_blocks(long *per_set, int s, int b, uint64_t start, long count, long step)
+{
+    uint64_t last = UINT64_MAX, blk;
+    long i;
+
+    /* Addresses increase monotonically, so repeats are always adjacent */
+    for (i = 0; i < count; i++) {
+        blk = (start + i * step) >> b;
+        if (blk != last)
+            per_set[blk & ((1 << s) - 1)]++;
+        last = blk;
+    }
+}
+
+/*
+ * expected - Compute the exact outcome of a case if one is known.
+ *     Returns 1 and fills want if so, 0 otherwise.
+ */
+static int expected(bench_case *c, int s, int E, int b, counts *want)
+{
+    long *per_set = calloc(1 << s, sizeof(long));
+    int sweep = strcmp(c->pattern, "seq") == 0 || strcmp(c->pattern, "stride") == 0;
+    int fits = 1, known = 1;
+    long i;
+
+    if (strcmp(c->pattern, "seq") == 0)
+        add_blocks(per_set, s, b, BASE, c->n, c->w);
+    else if (strcmp(c->pattern, "stride") == 0)
+        add_blocks(per_set, s, b, BASE, c->n, c->k);
+    else if (strcmp(c->pattern, "chase") == 0)
+        add_blocks(per_set, s, b, BASE, c->footprint / c->w, c->w);
+    else if (strcmp(c->pattern, "blocked") == 0)
+        add_blocks(per_set, s, b, BASE, 2 * c->n * c->n, sizeof(int));
+    else
+        known = 0;  /* uniform and zipf touch an unknown subset of blocks */
+
+    for (i = 0; i < (1 << s); i++)
+        if (per_set[i] > E)
+            fits = 0;
+
+    /* A chase touches every node only once it has gone round the cycle */
+    if (strcmp(c->pattern, "chase") == 0 && c->n < c->footprint / c->w)
+        known = 0;
+
+    memset(want, 0, sizeof(*want));
+    if (known && (sweep || fits)) {
+        for (i = 0; i < (1 << s); i++) {
+            if (per_set[i] <= E) {
+                want->misses += per_set[i];
+            } else {
+                want->misses += per_set[i] * c->passes;
+                want->evictions += per_set[i] * c->passes - E;
+            }
+        }
+        want->hits = c->accesses - want->misses;
+    } else {
+        known = 0;
+    }
+
+    free(per_set);
+    return known;
+}
+
+/*
+ * generate - Run patgen to write the trace of a case
+ */
+static void generate(bench_case *c)
+{
+    char cmd[512];
+    sprintf(cmd, "./patgen -p %s -n %ld -w %ld -k %ld -f %ld -r %ld -T %ld -a %llx -o %s",
+            c->pattern, c->n, c->w, c->k > 0 ? c->k : 64,
+            c->footprint > 0 ? c->footprint : c->w, c->passes,
+            c->tile > 0 ? c->tile : 8, BASE, BENCH_TRACE);
+    if (system(cmd) != 0) {
+        fprintf(stderr, "csimbench: %s failed\n", cmd);
+        exit(1);
+    }
+}
+
+/*
+ * run_csim - Run ./csim on the bench trace, collecting its counts, the
+ *     wall time in seconds and its peak RSS in KB
+ */
+static int run_csim(int s, int E, int b, counts *got, double *secs, long *maxrss)
+{
+    char sarg[16], Earg[16], barg[16], buf[256];
+    struct timespec start, end;
+    struct rusage usage;
+    int fds[2], status;
+    pid_t pid;
+    FILE *fp;
+
+    sprintf(sarg, "%d", s);
+    sprintf(Earg, "%d", E);
+    sprintf(barg, "%d", b);
+
+    if (pipe(fds) < 0) {
+        perror("pipe");
+        exit(1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if ((pid = fork()) == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execl("./csim", "./csim", "-s", sarg, "-E", Earg, "-b", barg,
+              "-t", BENCH_TRACE, (char *)NULL);
+        perror("./csim");
+        _exit(127);
+    }
+    close(fds[1]);
+
+    memset(got, 0, sizeof(*got));
+    fp = fdopen(fds[0], "r");
+    while (fgets(buf, sizeof(buf), fp) != NULL)
+        sscanf(buf, "hits:%ld misses:%ld evictions:%ld",
+               &got->hits, &got->misses, &got->evictions);
+    fclose(fp);
+
+    wait4(pid, &status, 0, &usage);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    *secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    *maxrss = usage.ru_maxrss;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+int main(int argc, char *argv[])
+{
+    int ncases = sizeof(cases) / sizeof(cases[0]);
+    int ngeoms = sizeof(geometries) / sizeof(geometries[0]);
+    int i, g, failures = 0;
+    counts got, want;
+    double secs;
+    long maxrss;
+
+    printf("%-8s %-9s %-10s %8s %8s %10s %10s %10s  %s\n", "pattern", "bytes/r",
+           "(s,E,b)", "Macc/s", "RSS(KB)", "hits", "misses", "evicts", "check");
+
+    for (i = 0; i < ncases; i++) {
+        bench_case *c = &cases[i];
+        char args[32];
+
+        generate(c);
+        sprintf(args, "%ld/%ld", c->footprint ? c->footprint : c->n * c->w, c->passes);
+
+        for (g = 0; g < ngeoms; g++) {
+            int s = geometries[g][0], E = geometries[g][1], b = geometries[g][2];
+            char geom[16], *check;
+
+            if (run_csim(s, E, b, &got, &secs, &maxrss) < 0) {
+                fprintf(stderr, "csimbench: ./csim failed\n");
+                exit(1);
+            }
+
+            if (!expected(c, s, E, b, &want)) {
+                check = "-";
+            } else if (got.hits == want.hits && got.misses == want.misses &&
+                       got.evictions == want.evictions) {
+                check = "ok";
+            } else {
+                check = "FAIL";
+                failures++;
+            }
+
+            sprintf(geom, "(%d,%d,%d)", s, E, b);
+            printf("%-8s %-9s %-10s %8.2f %8ld %10ld %10ld %10ld  %s",
+                   c->pattern, args, geom, c->accesses / secs / 1e6, maxrss,
+                   got.hits, got.misses, got.evictions, check);
+            if (check[0] == 'F')
+                printf(" (expected %ld %ld %ld)", want.hits, want.misses, want.evictions);
+            printf("\n");
+        }
+    }
+
+    unlink(BENCH_TRACE);
+    printf("\n%d mismatches against closed-form expectations\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * dram.c - Row-buffer timing model of a DRAM memory controller
+ *
+ * Addresses are interleaved as row:bank:channel:column, so consecutive
+ * row-sized chunks rotate over the channels and then over the banks.
+ * Each bank remembers its open row. Under the open-page policy an
+ * access to the open row costs only the column access, an access to a
+ * precharged bank adds the activate, and an access to another row adds
+ * the precharge as well. Under the closed-page policy every access is
+ * an activate followed by a column access. Requests are assumed to be
+ * served one at a time, so the cycle total is an upper bound that
+ * ignores bank-level parallelism.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dram.h"
+
+/* 
+ * parseDramConfig - Parse a controller description 
+ */
+int parseDramConfig(const char *spec, dram_config_t *cfg)
+{
+    char policy[8] = "open";
+    int n = sscanf(spec, "%d,%d,%d,%7s", &cfg->channels, &cfg->banks,
+                   &cfg->rows, policy);
+
+    if (n < 3 || cfg->channels <= 0 || cfg->banks <= 0 || cfg->rows <= 0)
+        return -1;
+
+    if (strcmp(policy, "open") == 0)
+        cfg->page_policy = PAGE_OPEN;
+    else if (strcmp(policy, "closed") == 0)
+        cfg->page_policy = PAGE_CLOSED;
+    else
+        return -1;
+
+    cfg->row_bytes = DRAM_ROW_BYTES;
+    return 0;
+}
+
+/* 
+ * dramInit - Set up a controller with every bank precharged 
+ */
+int dramInit(dram_t *d, const dram_config_t *cfg)
+{
+    int i, nbanks = cfg->channels * cfg->banks;
+
+    memset(d, 0, sizeof(*d));
+    d->cfg = *cfg;
+    if ((d->open_row = malloc(nbanks * sizeof(int64_t))) == NULL)
+        return -1;
+    for (i = 0; i < nbanks; i++)
+        d->open_row[i] = -1;
+    return 0;
+}
+
+/* 
+ * dramFree - Release the bank state 
+ */
+void dramFree(dram_t *d)
+{
+    free(d->open_row);
+    d->open_row = NULL;
+}
+
+/* 
+ * dramAccess - Serve one request 
+ */
+int dramAccess(dram_t *d, uint64_t addr, int write)
+{
+    uint64_t chunk = addr / d->cfg.row_bytes;
+    int channel = chunk % d->cfg.channels;
+    int bank;
+    int64_t row, *open;
+    int latency;
+
+    chunk /= d->cfg.channels;
+    bank = chunk % d->cfg.banks;
+    row = (chunk / d->cfg.banks) % d->cfg.rows;
+
+    open = &d->open_row[channel * d->cfg.banks + bank];
+
+    if (*open == row) {
+        d->row_hits++;
+        latency = DRAM_TCAS;
+    } else if (*open < 0) {
+        d->row_empty++;
+        latency = DRAM_TRCD + DRAM_TCAS;
+    } else {
+        d->row_conflicts++;
+        latency = DRAM_TRP + DRAM_TRCD + DRAM_TCAS;
+    }
+    latency += DRAM_TBURST;
+
+    /* Closed page hides the precharge behind the next request */
+    *open = d->cfg.page_policy == PAGE_OPEN ? row : -1;
+
+    if (write)
+        d->writes++;
+    else
+        d->reads++;
+    d->cycles += latency;
+    return latency;
+}
+
+/* 
+ * dramPrintStats - Summarize the controller's activity 
+ */
+void dramPrintStats(const dram_t *d)
+{
+    printf("DRAM (%d ch x %d banks x %d rows, %s page): reads:%ld writes:%ld "
+           "row_hits:%ld row_empty:%ld row_conflicts:%ld cycles:%lu\n",
+           d->cfg.channels, d->cfg.banks, d->cfg.rows,
+           d->cfg.page_policy == PAGE_OPEN ? "open" : "closed",
+           d->reads, d->writes, d->row_hits, d->row_empty, d->row_conflicts,
+           (unsigned long)d->cycles);
+}
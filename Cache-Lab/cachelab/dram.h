@@ -0,0 +1,62 @@
+/*
+ * dram.h - Row-buffer timing model of a DRAM memory controller, placed
+ *     behind the last simulated cache level
+ */
+
+#ifndef DRAM_H
+#define DRAM_H
+
+#include <stdint.h>
+
+/* Page policies */
+#define PAGE_OPEN   0   /* leave the row open after an access */
+#define PAGE_CLOSED 1   /* precharge the bank after every access */
+
+/* Default geometry and timing, in memory clock cycles (DDR4-2400-like) */
+#define DRAM_ROW_BYTES 8192
+#define DRAM_TCAS   16  /* column access on an open row */
+#define DRAM_TRCD   16  /* activate a row */
+#define DRAM_TRP    16  /* precharge (close) the open row */
+#define DRAM_TBURST 4   /* transfer one block */
+
+typedef struct dram_config{
+  int channels;
+  int banks;          /* per channel */
+  int rows;           /* per bank */
+  int row_bytes;
+  int page_policy;
+} dram_config_t;
+
+typedef struct dram{
+  dram_config_t cfg;
+  int64_t *open_row;  /* [channel * banks + bank], -1 if precharged */
+  long reads;
+  long writes;
+  long row_hits;      /* row already open */
+  long row_empty;     /* bank precharged, row had to be activated */
+  long row_conflicts; /* another row open, precharge + activate */
+  uint64_t cycles;    /* requests served back to back, no overlap */
+} dram_t;
+
+/*
+ * parseDramConfig - Parse "<channels>,<banks>,<rows>[,open|closed]".
+ * Returns 0 on success, -1 if the spec is malformed.
+ */
+int parseDramConfig(const char *spec, dram_config_t *cfg);
+
+/* Set up a controller with all banks precharged. Returns 0 or -1 */
+int dramInit(dram_t *d, const dram_config_t *cfg);
+
+/* Release the bank state of a controller */
+void dramFree(dram_t *d);
+
+/*
+ * dramAccess - Serve one block read or write at addr and return its
+ * latency in cycles.
+ */
+int dramAccess(dram_t *d, uint64_t addr, int write);
+
+/* Print the controller's counters */
+void dramPrintStats(const dram_t *d);
+
+#endif /* DRAM_H */
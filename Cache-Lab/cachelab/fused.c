@@ -0,0 +1,111 @@
+/*
+ * fused.c - Transposes fused with the pass over B that usually follows
+ *     them: B = alpha * A^T, B = alpha * A^T + C and B = (float)A^T
+ *
+ * Each fused kernel is the schedule of trans_2 from schedule.h: square
+ * tiles one cache block wide (sized from the target cache, see
+ * setTransCache), split into quadrants, with the top-right quadrant of
+ * A parked in B until it can be stored in its place. The operation is
+ * the schedule's element hook, applied as each element reaches its
+ * final place in B, so B is written once and C is read alongside it.
+ * Shapes the tile does not divide use the plain tiles of trans_1.
+ *
+ * For comparison, each operation also has a two-pass version: the same
+ * schedule as a bare transpose, then a row-wise pass over B. test-trans
+ * evaluates them (-f) from a build with TRACE_CFLAGS.
+ */
+#include "cachelab.h"
+#include "schedule.h"
+
+/* An element of B that the two-pass FUSED_TO_FLOAT holds as an int
+   between its passes */
+typedef union {
+    int i;
+    float f;
+} fused_word_t;
+
+/* The operation applied to element v of A as it reaches B[r][col]; c is
+   the matrix C of FUSED_AXPY, N ints wide */
+#define FINAL_COPY(v, r, col)     (v)
+#define FINAL_SCALE(v, r, col)    (FUSED_ALPHA * (v))
+#define FINAL_AXPY(v, r, col)     (FUSED_ALPHA * (v) + c[(r) * N + (col)])
+#define FINAL_TO_FLOAT(v, r, col) ((float)(v))
+
+SCHED_KERNELS(copy, int, FINAL_COPY)
+SCHED_KERNELS(scale, int, FINAL_SCALE)
+SCHED_KERNELS(axpy, int, FINAL_AXPY)
+SCHED_KERNELS(to_float, float, FINAL_TO_FLOAT)
+
+/*
+ * fused_<name> - B[r][col] = FINAL(A[col][r], r, col) on the schedule
+ *     of trans_2
+ */
+#define FUSED_KERNEL(name, btype) \
+static void fused_##name(int M, int N, void *arrays[]) \
+{ \
+    int th, tw; \
+    tileForCache(&th, &tw); \
+    name##_squares(th, tw, M, N, arrays[0], arrays[1], arrays[2]); \
+}
+
+FUSED_KERNEL(copy, int)
+FUSED_KERNEL(scale, int)
+FUSED_KERNEL(axpy, int)
+FUSED_KERNEL(to_float, float)
+
+/*
+ * two_pass_scale - Transpose, then scale B row by row
+ */
+static void two_pass_scale(int M, int N, void *arrays[])
+{
+    int (*B)[N] = arrays[1];
+    int i, j;
+
+    fused_copy(M, N, arrays);
+    for (i = 0; i < M; i++)
+        for (j = 0; j < N; j++)
+            B[i][j] = FUSED_ALPHA * B[i][j];
+}
+
+/*
+ * two_pass_axpy - Transpose, then scale B and add C row by row
+ */
+static void two_pass_axpy(int M, int N, void *arrays[])
+{
+    int (*B)[N] = arrays[1];
+    const int (*C)[N] = arrays[2];
+    int i, j;
+
+    fused_copy(M, N, arrays);
+    for (i = 0; i < M; i++)
+        for (j = 0; j < N; j++)
+            B[i][j] = FUSED_ALPHA * B[i][j] + C[i][j];
+}
+
+/*
+ * two_pass_to_float - Transpose the ints into B, then convert B in place
+ */
+static void two_pass_to_float(int M, int N, void *arrays[])
+{
+    fused_word_t (*B)[N] = arrays[1];
+    int i, j;
+
+    fused_copy(M, N, arrays);
+    for (i = 0; i < M; i++)
+        for (j = 0; j < N; j++)
+            B[i][j].f = (float)B[i][j].i;
+}
+
+/*
+ * registerFusedFunctions - Register each fused kernel and its two-pass
+ *     equivalent
+ */
+void registerFusedFunctions(void)
+{
+    registerClassFunction(&fused_classes[FUSED_SCALE], fused_scale, "Fused transpose-scale", 0);
+    registerClassFunction(&fused_classes[FUSED_SCALE], two_pass_scale, "Transpose, then scale", 1);
+    registerClassFunction(&fused_classes[FUSED_AXPY], fused_axpy, "Fused transpose-scale-add", 0);
+    registerClassFunction(&fused_classes[FUSED_AXPY], two_pass_axpy, "Transpose, then scale and add", 1);
+    registerClassFunction(&fused_classes[FUSED_TO_FLOAT], fused_to_float, "Fused transpose-convert", 0);
+    registerClassFunction(&fused_classes[FUSED_TO_FLOAT], two_pass_to_float, "Transpose, then convert", 1);
+}
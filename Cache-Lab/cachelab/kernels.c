@@ -0,0 +1,218 @@
+/*
+ * kernels.c - Cache-sensitive kernels other than transposes, evaluated
+ *     by test-trans -k through the kernel families of cachelab.c
+ *
+ * For each family there is a straightforward kernel and one tuned for
+ * the target cache (see setTransCache): tiles and register blocks are
+ * one cache block of ints wide, as in trans.c. Every kernel has the
+ * signature (M, N, arrays), with the arrays laid out as the family
+ * describes. test-trans traces them from a build with TRACE_CFLAGS and
+ * tracegen runs them under valgrind (-K).
+ */
+#include "cachelab.h"
+#include "tile.h"
+
+/*
+ * gemm_naive - One dot product of a row of A and a column of B per
+ *     element of C
+ */
+static void gemm_naive(int M, int N, void *arrays[])
+{
+    int (*A)[M] = (int (*)[M])arrays[0];
+    int (*B)[N] = (int (*)[N])arrays[1];
+    int (*C)[N] = (int (*)[N])arrays[2];
+    int i, j, k, sum;
+
+    for (i = 0; i < N; i++) {
+        for (j = 0; j < N; j++) {
+            sum = 0;
+            for (k = 0; k < M; k++)
+                sum += A[i][k] * B[k][j];
+            C[i][j] = sum;
+        }
+    }
+}
+
+/*
+ * gemm_blocked - For each block of th rows of B and tw columns of C, every
+ *     row of A updates its row segment of C, held in locals, with the
+ *     block of B. The block stays in the cache while A streams past it.
+ */
+static void gemm_blocked(int M, int N, void *arrays[])
+{
+    int (*A)[M] = (int (*)[M])arrays[0];
+    int (*B)[N] = (int (*)[N])arrays[1];
+    int (*C)[N] = (int (*)[N])arrays[2];
+    int i, j, k, kk, jj, k1, j1, th, tw, a;
+    int c[TILE_MAX_WIDTH];
+
+    tileForCache(&th, &tw);
+    for (i = 0; i < N; i++)
+        for (j = 0; j < N; j++)
+            C[i][j] = 0;
+    for (kk = 0; kk < M; kk += th) {
+        k1 = kk + th < M ? kk + th : M;
+        for (jj = 0; jj < N; jj += tw) {
+            j1 = jj + tw < N ? jj + tw : N;
+            for (i = 0; i < N; i++) {
+                for (j = jj; j < j1; j++)
+                    c[j - jj] = C[i][j];
+                for (k = kk; k < k1; k++) {
+                    a = A[i][k];
+                    for (j = jj; j < j1; j++)
+                        c[j - jj] += a * B[k][j];
+                }
+                for (j = jj; j < j1; j++)
+                    C[i][j] = c[j - jj];
+            }
+        }
+    }
+}
+
+/*
+ * stencil_naive - Each element of B from its five neighbours in A
+ */
+static void stencil_naive(int M, int N, void *arrays[])
+{
+    int (*A)[M] = (int (*)[M])arrays[0];
+    int (*B)[M] = (int (*)[M])arrays[1];
+    int i, j;
+
+    for (i = 0; i < N; i++) {
+        for (j = 0; j < M; j++) {
+            if (i > 0 && i < N - 1 && j > 0 && j < M - 1)
+                B[i][j] = A[i][j] + A[i - 1][j] + A[i + 1][j] + A[i][j - 1] + A[i][j + 1];
+            else
+                B[i][j] = A[i][j];
+        }
+    }
+}
+
+/*
+ * stencil_blocked - A row segment of B at a time: the segment of A with
+ *     one element either side, then the rows above and below, are summed
+ *     in locals before the segment is stored. A[i][j] and B[i][j] map to
+ *     the same set when the arrays are aligned alike, so reading A and
+ *     writing B a whole block at a time avoids a conflict per element.
+ */
+static void stencil_blocked(int M, int N, void *arrays[])
+{
+    int (*A)[M] = (int (*)[M])arrays[0];
+    int (*B)[M] = (int (*)[M])arrays[1];
+    int i, j, jj, j0, j1, th, tw;
+    int mid[TILE_MAX_WIDTH + 2], out[TILE_MAX_WIDTH];
+
+    tileForCache(&th, &tw);
+    for (i = 0; i < N; i++) {
+        for (jj = 0; jj < M; jj += tw) {
+            j1 = jj + tw < M ? jj + tw : M;
+            if (i == 0 || i == N - 1) {
+                for (j = jj; j < j1; j++)
+                    out[j - jj] = A[i][j];
+            } else {
+                j0 = jj > 0 ? jj - 1 : 0;
+                for (j = j0; j < j1 + 1 && j < M; j++)
+                    mid[j - jj + 1] = A[i][j];
+                for (j = jj; j < j1; j++)
+                    out[j - jj] = mid[j - jj + 1];
+                for (j = jj; j < j1; j++)
+                    if (j > 0 && j < M - 1)
+                        out[j - jj] += A[i - 1][j];
+                for (j = jj; j < j1; j++)
+                    if (j > 0 && j < M - 1)
+                        out[j - jj] += A[i + 1][j] + mid[j - jj] + mid[j - jj + 2];
+            }
+            for (j = jj; j < j1; j++)
+                B[i][j] = out[j - jj];
+        }
+    }
+}
+
+/*
+ * matvec_columns - y = A x a column of A at a time, so that every
+ *     access to A is a row apart from the last
+ */
+static void matvec_columns(int M, int N, void *arrays[])
+{
+    int (*A)[M] = (int (*)[M])arrays[0];
+    int *x = arrays[1], *y = arrays[2];
+    int i, j;
+
+    for (i = 0; i < N; i++)
+        y[i] = 0;
+    for (j = 0; j < M; j++)
+        for (i = 0; i < N; i++)
+            y[i] += A[i][j] * x[j];
+}
+
+/*
+ * matvec_rows - y = A x as one dot product per row of A
+ */
+static void matvec_rows(int M, int N, void *arrays[])
+{
+    int (*A)[M] = (int (*)[M])arrays[0];
+    int *x = arrays[1], *y = arrays[2];
+    int i, j, sum;
+
+    for (i = 0; i < N; i++) {
+        sum = 0;
+        for (j = 0; j < M; j++)
+            sum += A[i][j] * x[j];
+        y[i] = sum;
+    }
+}
+
+/*
+ * matvec_blocked - Four rows of A per pass over x, each element of x
+ *     loaded once for all four. Each pass reads x in segments one block
+ *     wide, so that x and the four rows, which may share sets, are
+ *     touched a block at a time.
+ */
+static void matvec_blocked(int M, int N, void *arrays[])
+{
+    int (*A)[M] = (int (*)[M])arrays[0];
+    int *x = arrays[1], *y = arrays[2];
+    int i, j, jj, j1, th, tw, xj, y0, y1, y2, y3;
+    int xs[TILE_MAX_WIDTH];
+
+    tileForCache(&th, &tw);
+    for (i = 0; i + 3 < N; i += 4) {
+        y0 = y1 = y2 = y3 = 0;
+        for (jj = 0; jj < M; jj += tw) {
+            j1 = jj + tw < M ? jj + tw : M;
+            for (j = jj; j < j1; j++)
+                xs[j - jj] = x[j];
+            for (j = jj; j < j1; j++) {
+                xj = xs[j - jj];
+                y0 += A[i][j] * xj;
+                y1 += A[i + 1][j] * xj;
+                y2 += A[i + 2][j] * xj;
+                y3 += A[i + 3][j] * xj;
+            }
+        }
+        y[i] = y0;
+        y[i + 1] = y1;
+        y[i + 2] = y2;
+        y[i + 3] = y3;
+    }
+    for (; i < N; i++) {
+        y0 = 0;
+        for (j = 0; j < M; j++)
+            y0 += A[i][j] * x[j];
+        y[i] = y0;
+    }
+}
+
+/*
+ * registerKernelFunctions - Register every kernel with its family
+ */
+void registerKernelFunctions(void)
+{
+    registerClassFunction(&gemm_class, gemm_blocked, "Blocked matrix multiply", 0);
+    registerClassFunction(&gemm_class, gemm_naive, "Simple ijk matrix multiply", 0);
+    registerClassFunction(&stencil_class, stencil_blocked, "Row-segment 5-point stencil", 0);
+    registerClassFunction(&stencil_class, stencil_naive, "Simple 5-point stencil", 0);
+    registerClassFunction(&matvec_class, matvec_blocked, "Four-row matrix-vector product", 0);
+    registerClassFunction(&matvec_class, matvec_rows, "Row-order matrix-vector product", 0);
+    registerClassFunction(&matvec_class, matvec_columns, "Column-order matrix-vector product", 0);
+}
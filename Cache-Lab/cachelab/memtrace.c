@@ -0,0 +1,121 @@
+/*
+ * memtrace.c - Recording side of the in-process tracer. This file must
+ *     not itself be compiled with TRACE_CFLAGS.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "memtrace.h"
+
+/* Per-thread tracer state */
+static __thread struct {
+    unsigned long long lo, hi;
+} regions[MAX_TRACE_REGIONS];
+static __thread int num_regions = 0;
+
+static __thread int recording = 0;
+static __thread mem_access_t *buffer = NULL;
+static __thread int buffer_len = 0, buffer_cap = 0;
+
+/* 
+ * memtraceAddRegion - Add an address range to record 
+ */
+void memtraceAddRegion(const void *base, size_t len)
+{
+    if (num_regions == MAX_TRACE_REGIONS) {
+        fprintf(stderr, "memtrace: too many regions\n");
+        exit(1);
+    }
+    regions[num_regions].lo = (unsigned long long)base;
+    regions[num_regions].hi = (unsigned long long)base + len;
+    num_regions++;
+}
+
+/* 
+ * memtraceClearRegions - Forget all address ranges 
+ */
+void memtraceClearRegions(void)
+{
+    num_regions = 0;
+}
+
+/* 
+ * memtraceStart - Reset the buffer and turn recording on 
+ */
+void memtraceStart(void)
+{
+    buffer_len = 0;
+    recording = 1;
+}
+
+/* 
+ * memtraceStop - Turn recording off and hand back the buffer 
+ */
+mem_access_t *memtraceStop(int *count)
+{
+    recording = 0;
+    *count = buffer_len;
+    return buffer;
+}
+
+/* 
+ * memtraceFree - Drop the buffer 
+ */
+void memtraceFree(void)
+{
+    free(buffer);
+    buffer = NULL;
+    buffer_len = buffer_cap = 0;
+    recording = 0;
+}
+
+/* 
+ * record - Append one access if recording and inside a region 
+ */
+static void record(unsigned long addr, char op, unsigned char size)
+{
+    int i;
+
+    if (!recording)
+        return;
+    for (i = 0; i < num_regions; i++)
+        if (addr >= regions[i].lo && addr < regions[i].hi)
+            break;
+    if (i == num_regions)
+        return;
+
+    if (buffer_len == buffer_cap) {
+        buffer_cap = buffer_cap ? buffer_cap * 2 : 1 << 16;
+        if ((buffer = realloc(buffer, buffer_cap * sizeof(mem_access_t))) == NULL) {
+            fprintf(stderr, "memtrace: out of memory\n");
+            exit(1);
+        }
+    }
+    buffer[buffer_len].addr = addr;
+    buffer[buffer_len].op = op;
+    buffer[buffer_len].size = size;
+    buffer_len++;
+}
+
+/* 
+ * Hooks called by the instrumented code, one per access size 
+ */
+#define MEMTRACE_HOOKS(size) \
+    void __asan_load##size##_noabort(unsigned long addr); \
+    void __asan_store##size##_noabort(unsigned long addr); \
+    void __asan_load##size##_noabort(unsigned long addr) { record(addr, 'L', size); } \
+    void __asan_store##size##_noabort(unsigned long addr) { record(addr, 'S', size); }
+
+MEMTRACE_HOOKS(1)
+MEMTRACE_HOOKS(2)
+MEMTRACE_HOOKS(4)
+MEMTRACE_HOOKS(8)
+MEMTRACE_HOOKS(16)
+
+void __asan_loadN_noabort(unsigned long addr, unsigned long size);
+void __asan_storeN_noabort(unsigned long addr, unsigned long size);
+void __asan_loadN_noabort(unsigned long addr, unsigned long size) { record(addr, 'L', size); }
+void __asan_storeN_noabort(unsigned long addr, unsigned long size) { record(addr, 'S', size); }
+
+/* Called before noreturn functions; nothing to unpoison here */
+void __asan_handle_no_return(void);
+void __asan_handle_no_return(void) { }
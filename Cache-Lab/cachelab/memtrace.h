@@ -0,0 +1,48 @@
+/*
+ * memtrace.h - In-process memory tracing of transpose functions
+ *
+ * trans.c is compiled a second time with the compiler's address
+ * sanitizer instrumentation switched to out-of-line callbacks
+ * (TRACE_CFLAGS in the Makefile). Every load and store the transpose
+ * functions make then calls one of the __asan_* hooks defined in
+ * memtrace.c, which append the accesses that fall inside the
+ * registered regions to an in-memory buffer. This replaces running
+ * tracegen under valgrind.
+ *
+ * All state (regions, buffer, recording flag) is per thread, so several
+ * functions can be traced concurrently from different threads.
+ */
+
+#ifndef MEMTRACE_H
+#define MEMTRACE_H
+
+#include <stddef.h>
+
+#define MAX_TRACE_REGIONS 4
+
+/* One recorded access */
+typedef struct mem_access{
+  unsigned long long addr;
+  char op;            /* 'L' or 'S' */
+  unsigned char size;
+} mem_access_t;
+
+/* Restrict recording to [base, base+len). Up to MAX_TRACE_REGIONS. */
+void memtraceAddRegion(const void *base, size_t len);
+
+/* Forget all regions */
+void memtraceClearRegions(void);
+
+/* Discard the buffer and start recording */
+void memtraceStart(void);
+
+/*
+ * memtraceStop - Stop recording and return the buffer, which stays
+ * valid until the next memtraceStart. The access count goes in *count.
+ */
+mem_access_t *memtraceStop(int *count);
+
+/* Release the calling thread's buffer */
+void memtraceFree(void);
+
+#endif /* MEMTRACE_H */
@@ -0,0 +1,140 @@
+/*
+ * parbench.c - Measures how the multithreaded transpose of partrans.c
+ *     scales with matrix size and thread count.
+ *
+ * For each square size from -n to -x (doubling) and each thread count
+ * from 1 up to -t (doubling, plus -t itself), B is freshly allocated and
+ * first-touched by the pool that then transposes into it. Throughput is
+ * the best of several runs, counting one read of A and one write of B:
+ * GB/s = 2 * M * N * sizeof(int) / seconds / 1e9. Sizes that do not fit
+ * in most of physical memory are skipped.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include "partrans.h"
+#include "simd.h"
+
+#define TIME_RUNS 3
+
+static double seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * check - Spot-check B against the values partransFill put in A
+ */
+static int check(int n, const int *B)
+{
+    long i, j, step = n / 61 + 1;
+
+    for (i = 0; i < n; i += step)
+        for (j = 0; j < n; j += step)
+            if (B[j * n + i] != (int)(i * n + j))
+                return 0;
+    return B[(long)n * n - 1] == (int)((long)n * n - 1);
+}
+
+static void usage(char *argv[])
+{
+    printf("Usage: %s [-h] [-n <min>] [-x <max>] [-t <threads>]\n", argv[0]);
+    printf("Options:\n");
+    printf("  -n <min>      Smallest matrix side (default 1024)\n");
+    printf("  -x <max>      Largest matrix side (default 32768)\n");
+    printf("  -t <threads>  Most threads to use (default: all CPUs)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int min = 1024, max = 32768, max_threads = 0, n, t, run, last;
+    double memory, bytes, start, best, base = 0;
+    partrans_t *pool;
+    int *A, *B;
+    char c;
+
+    while ((c = getopt(argc, argv, "n:x:t:h")) != -1) {
+        switch (c) {
+        case 'n': min = atoi(optarg); break;
+        case 'x': max = atoi(optarg); break;
+        case 't': max_threads = atoi(optarg); break;
+        case 'h':
+            usage(argv);
+            exit(0);
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+    if (min <= 0 || max < min || max_threads < 0) {
+        usage(argv);
+        exit(1);
+    }
+
+    /* Find out how many CPUs the pool would use */
+    if (max_threads == 0) {
+        pool = partransCreate(0);
+        max_threads = partransThreads(pool);
+        partransFree(pool);
+    }
+    memory = (double)sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE);
+
+    printf("SIMD level %s, up to %d threads\n", simdLevelName(simdLevel()), max_threads);
+    printf("%7s %7s %10s %8s %8s\n", "size", "threads", "ms", "GB/s", "speedup");
+
+    for (n = min; n <= max; n *= 2) {
+        bytes = 2.0 * n * n * sizeof(int);
+        if (bytes > 0.75 * memory) {
+            printf("%7d skipped: needs %.1f GB of %.1f GB\n", n, bytes / 1e9, memory / 1e9);
+            continue;
+        }
+        if ((A = malloc((size_t)n * n * sizeof(int))) == NULL) {
+            printf("%7d skipped: out of memory\n", n);
+            continue;
+        }
+        pool = partransCreate(max_threads);
+        partransFill(pool, n, n, A);
+        partransFree(pool);
+
+        for (t = 1, last = 0; !last; t *= 2) {
+            if (t >= max_threads) {
+                t = max_threads;
+                last = 1;
+            }
+            if ((B = malloc((size_t)n * n * sizeof(int))) == NULL) {
+                printf("%7d skipped: out of memory\n", n);
+                break;
+            }
+            pool = partransCreate(t);
+            partransFirstTouch(pool, n, n, B);
+
+            best = 0;
+            for (run = 0; run < TIME_RUNS; run++) {
+                start = seconds();
+                partransTranspose(pool, n, n, A, B);
+                start = seconds() - start;
+                if (run == 0 || start < best)
+                    best = start;
+            }
+            if (!check(n, B)) {
+                printf("parbench: wrong result at size %d with %d threads\n", n, t);
+                exit(1);
+            }
+            if (t == 1)
+                base = best;
+            printf("%7d %7d %10.2f %8.2f %8.2f\n", n, t, best * 1e3,
+                   bytes / best / 1e9, base / best);
+            fflush(stdout);
+
+            partransFree(pool);
+            free(B);
+        }
+        free(A);
+    }
+    return 0;
+}
@@ -0,0 +1,225 @@
+/*
+ * partrans.c - Thread pool and band partitioning for partrans.h
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include "partrans.h"
+#include "simd.h"
+
+/* Work the pool can be asked to do */
+#define TASK_FILL      0
+#define TASK_TOUCH     1
+#define TASK_TRANSPOSE 2
+
+typedef struct {
+    partrans_t *pool;
+    int index;
+    int cpu;            /* CPU to pin to, or -1 */
+    pthread_t tid;
+} worker_t;
+
+struct partrans {
+    int threads;
+    worker_t *workers;
+
+    pthread_mutex_t lock;
+    pthread_cond_t start;       /* a new task was posted */
+    pthread_cond_t done;        /* the last worker finished it */
+    unsigned long generation;   /* bumped for every task */
+    int pending;                /* workers still on the current task */
+    int quit;
+
+    /* The current task */
+    int task, M, N;
+    const int *A;
+    int *B;
+};
+
+/*
+ * band - The share [*lo, *hi) of n items for worker k of count, in whole
+ *     PAR_TILE units so that no tile is split between workers
+ */
+static void band(int n, int k, int count, int *lo, int *hi)
+{
+    int tiles = (n + PAR_TILE - 1) / PAR_TILE;
+    *lo = (int)((long)tiles * k / count) * PAR_TILE;
+    *hi = (int)((long)tiles * (k + 1) / count) * PAR_TILE;
+    if (*lo > n)
+        *lo = n;
+    if (*hi > n)
+        *hi = n;
+}
+
+/*
+ * run_task - Worker k's part of the current task
+ */
+static void run_task(partrans_t *pool, int k)
+{
+    int M = pool->M, N = pool->N, lo, hi, i, j, ii, jj;
+
+    switch (pool->task) {
+    case TASK_FILL:
+        band(N, k, pool->threads, &lo, &hi);
+        for (i = lo; i < hi; i++)
+            for (j = 0; j < M; j++)
+                pool->B[(size_t)i * M + j] = (int)((long)i * M + j);
+        break;
+
+    case TASK_TOUCH:
+        band(M, k, pool->threads, &lo, &hi);
+        if (hi > lo)
+            memset(pool->B + (size_t)lo * N, 0, (size_t)(hi - lo) * N * sizeof(int));
+        break;
+
+    case TASK_TRANSPOSE:
+        /* Rows [lo,hi) of B are columns [lo,hi) of A */
+        band(M, k, pool->threads, &lo, &hi);
+        for (jj = lo; jj < hi; jj += PAR_TILE)
+            for (ii = 0; ii < N; ii += PAR_TILE)
+                simdTransposeRect(M, N, (int (*)[M])pool->A, (int (*)[N])pool->B,
+                                  ii, ii + PAR_TILE < N ? ii + PAR_TILE : N,
+                                  jj, jj + PAR_TILE < hi ? jj + PAR_TILE : hi);
+        break;
+    }
+}
+
+/*
+ * worker - Pin to a CPU, then run each posted task until told to quit
+ */
+static void *worker(void *arg)
+{
+    worker_t *w = arg;
+    partrans_t *pool = w->pool;
+    unsigned long seen = 0;
+    cpu_set_t set;
+
+    if (w->cpu >= 0) {
+        CPU_ZERO(&set);
+        CPU_SET(w->cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->generation == seen && !pool->quit)
+            pthread_cond_wait(&pool->start, &pool->lock);
+        if (pool->quit) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        run_task(pool, w->index);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0)
+            pthread_cond_signal(&pool->done);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+/*
+ * post - Hand a task to every worker and wait for all of them
+ */
+static void post(partrans_t *pool, int task, int M, int N, const int *A, int *B)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->M = M;
+    pool->N = N;
+    pool->A = A;
+    pool->B = B;
+    pool->pending = pool->threads;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    while (pool->pending > 0)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+partrans_t *partransCreate(int threads)
+{
+    partrans_t *pool;
+    cpu_set_t allowed;
+    int k, cpu, ncpus = 0, *cpus;
+
+    /* The CPUs we may run on, in order, to spread the workers over */
+    cpus = malloc(CPU_SETSIZE * sizeof(int));
+    if (cpus == NULL)
+        return NULL;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            if (CPU_ISSET(cpu, &allowed))
+                cpus[ncpus++] = cpu;
+    }
+    if (threads <= 0)
+        threads = ncpus > 0 ? ncpus : (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    if ((pool = calloc(1, sizeof(partrans_t))) == NULL ||
+        (pool->workers = calloc(threads, sizeof(worker_t))) == NULL) {
+        free(pool);
+        free(cpus);
+        return NULL;
+    }
+    pool->threads = threads;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for (k = 0; k < threads; k++) {
+        worker_t *w = &pool->workers[k];
+        w->pool = pool;
+        w->index = k;
+        w->cpu = ncpus > 0 ? cpus[k % ncpus] : -1;
+        if (pthread_create(&w->tid, NULL, worker, w) != 0) {
+            fprintf(stderr, "partrans: unable to start worker thread\n");
+            exit(1);
+        }
+    }
+    free(cpus);
+    return pool;
+}
+
+void partransFree(partrans_t *pool)
+{
+    int k;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (k = 0; k < pool->threads; k++)
+        pthread_join(pool->workers[k].tid, NULL);
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+    free(pool->workers);
+    free(pool);
+}
+
+int partransThreads(const partrans_t *pool)
+{
+    return pool->threads;
+}
+
+void partransFill(partrans_t *pool, int M, int N, int *A)
+{
+    post(pool, TASK_FILL, M, N, NULL, A);
+}
+
+void partransFirstTouch(partrans_t *pool, int M, int N, int *B)
+{
+    post(pool, TASK_TOUCH, M, N, NULL, B);
+}
+
+void partransTranspose(partrans_t *pool, int M, int N, const int *A, int *B)
+{
+    post(pool, TASK_TRANSPOSE, M, N, A, B);
+}
@@ -0,0 +1,41 @@
+/*
+ * partrans.h - Multithreaded tiled transpose for large matrices
+ *
+ * A pool of worker threads, each pinned to one CPU, splits B = A^T into
+ * contiguous bands of B's rows (columns of A). Each worker writes only
+ * its own band, and partransFirstTouch has the same worker touch that
+ * band first, so on a NUMA machine the pages of B are placed on the
+ * node of the thread that later writes them. Within a band the work is
+ * done in PAR_TILE x PAR_TILE tiles by the SIMD kernels of simd.c.
+ *
+ * Matrices are plain row-major arrays: A has N rows of M ints and B has
+ * M rows of N ints.
+ */
+
+#ifndef PARTRANS_H
+#define PARTRANS_H
+
+/* Side of the cache-level tiles handed to simdTransposeRect */
+#define PAR_TILE 64
+
+typedef struct partrans partrans_t;
+
+/* Start a pool of threads workers (0 for one per CPU). NULL on error. */
+partrans_t *partransCreate(int threads);
+
+/* Stop the workers and free the pool */
+void partransFree(partrans_t *pool);
+
+/* Number of workers */
+int partransThreads(const partrans_t *pool);
+
+/* Set A[i][j] = i * M + j, each worker filling a band of rows of A */
+void partransFill(partrans_t *pool, int M, int N, int *A);
+
+/* Zero B, each worker touching the band it will write */
+void partransFirstTouch(partrans_t *pool, int M, int N, int *B);
+
+/* B = A^T */
+void partransTranspose(partrans_t *pool, int M, int N, const int *A, int *B);
+
+#endif /* PARTRANS_H */
@@ -0,0 +1,242 @@
+/*
+ * patgen.c - Generates synthetic memory traces in the valgrind/lackey
+ * format read by csim (" L addr,size" / " S addr,size").
+ *
+ * Patterns:
+ *   seq      sweep n elements of w bytes from the base, r times
+ *   stride   n accesses k bytes apart from the base, r times
+ *   uniform  n accesses to uniformly random elements of the footprint
+ *   zipf     n accesses to elements of the footprint with zipf(theta)
+ *            popularity, element 0 being the most popular
+ *   chase    n hops along a random single-cycle linked list of
+ *            w-byte nodes covering the footprint
+ *   blocked  r passes of a T x T tiled transpose of an int matrix A
+ *            of n x n elements into B, which follows A in memory
+ *
+ * The random patterns use a seeded splitmix64 generator, so the same
+ * arguments always produce the same trace on every platform.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <getopt.h>
+
+/* Generator parameters, set on the command line */
+static char *pattern = NULL;
+static long n = 0;                   /* accesses, elements or matrix size */
+static long w = 4;                   /* element or node size in bytes */
+static long k = 64;                  /* stride in bytes */
+static long footprint = 1 << 20;     /* bytes covered by random patterns */
+static long passes = 1;
+static long tile = 8;
+static double theta = 0.99;
+static uint64_t seed = 1;
+static unsigned long long base = 0x10000000;
+
+static FILE *out;
+
+/*
+ * next_random - splitmix64 step
+ */
+static uint64_t next_random(void)
+{
+    uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/*
+ * random_below - Uniform integer in [0, limit)
+ */
+static uint64_t random_below(uint64_t limit)
+{
+    return next_random() % limit;
+}
+
+static void emit(char op, unsigned long long addr, long size)
+{
+    fprintf(out, " %c %llx,%ld\n", op, addr, size);
+}
+
+static void gen_seq(void)
+{
+    long p, i;
+    for (p = 0; p < passes; p++)
+        for (i = 0; i < n; i++)
+            emit('L', base + i * w, w);
+}
+
+static void gen_stride(void)
+{
+    long p, i;
+    for (p = 0; p < passes; p++)
+        for (i = 0; i < n; i++)
+            emit('L', base + i * k, w);
+}
+
+static void gen_uniform(void)
+{
+    long elements = footprint / w, i;
+    for (i = 0; i < n; i++)
+        emit('L', base + random_below(elements) * w, w);
+}
+
+/*
+ * gen_zipf - Inverse-CDF sampling over a precomputed cumulative table
+ */
+static void gen_zipf(void)
+{
+    long elements = footprint / w, i, lo, hi, mid;
+    double *cdf = malloc(elements * sizeof(double)), sum = 0, u;
+
+    if (cdf == NULL) {
+        fprintf(stderr, "patgen: out of memory\n");
+        exit(1);
+    }
+    for (i = 0; i < elements; i++) {
+        sum += 1.0 / pow(i + 1, theta);
+        cdf[i] = sum;
+    }
+
+    for (i = 0; i < n; i++) {
+        u = (next_random() >> 11) * (1.0 / 9007199254740992.0) * sum;
+        lo = 0;
+        hi = elements - 1;
+        while (lo < hi) {
+            mid = (lo + hi) / 2;
+            if (cdf[mid] < u)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        emit('L', base + lo * w, w);
+    }
+    free(cdf);
+}
+
+/*
+ * gen_chase - Sattolo's shuffle gives a permutation with a single cycle,
+ *     so the chain visits every node before repeating
+ */
+static void gen_chase(void)
+{
+    long nodes = footprint / w, i, j, tmp, cur = 0;
+    long *next = malloc(nodes * sizeof(long));
+
+    if (next == NULL) {
+        fprintf(stderr, "patgen: out of memory\n");
+        exit(1);
+    }
+    for (i = 0; i < nodes; i++)
+        next[i] = i;
+    for (i = nodes - 1; i > 0; i--) {
+        j = random_below(i);
+        tmp = next[i];
+        next[i] = next[j];
+        next[j] = tmp;
+    }
+
+    for (i = 0; i < n; i++) {
+        emit('L', base + cur * w, 8);
+        cur = next[cur];
+    }
+    free(next);
+}
+
+static void gen_blocked(void)
+{
+    unsigned long long a = base, b = base + n * n * sizeof(int);
+    long p, ii, jj, i, j;
+
+    for (p = 0; p < passes; p++)
+        for (ii = 0; ii < n; ii += tile)
+            for (jj = 0; jj < n; jj += tile)
+                for (i = ii; i < ii + tile && i < n; i++)
+                    for (j = jj; j < jj + tile && j < n; j++) {
+                        emit('L', a + (i * n + j) * sizeof(int), sizeof(int));
+                        emit('S', b + (j * n + i) * sizeof(int), sizeof(int));
+                    }
+}
+
+static void usage(char *argv[])
+{
+    printf("Usage: %s -p <pattern> -n <count> [options]\n", argv[0]);
+    printf("Patterns: seq stride uniform zipf chase blocked\n");
+    printf("Options:\n");
+    printf("  -n <count>   Accesses (matrix dimension for blocked)\n");
+    printf("  -w <bytes>   Element or node size (default 4)\n");
+    printf("  -k <bytes>   Stride for the stride pattern (default 64)\n");
+    printf("  -f <bytes>   Footprint of uniform, zipf and chase (default 1M)\n");
+    printf("  -r <passes>  Repetitions of seq, stride and blocked (default 1)\n");
+    printf("  -T <tile>    Tile size for blocked (default 8)\n");
+    printf("  -z <theta>   Zipf exponent (default 0.99)\n");
+    printf("  -S <seed>    Random seed (default 1)\n");
+    printf("  -a <base>    Base address in hex (default 10000000)\n");
+    printf("  -o <file>    Output file (default stdout)\n");
+}
+
+int main(int argc, char* argv[])
+{
+    char *outname = NULL;
+    int c;
+
+    while ((c = getopt(argc, argv, "p:n:w:k:f:r:T:z:S:a:o:h")) != -1) {
+        switch (c) {
+        case 'p': pattern = optarg; break;
+        case 'n': n = atol(optarg); break;
+        case 'w': w = atol(optarg); break;
+        case 'k': k = atol(optarg); break;
+        case 'f': footprint = atol(optarg); break;
+        case 'r': passes = atol(optarg); break;
+        case 'T': tile = atol(optarg); break;
+        case 'z': theta = atof(optarg); break;
+        case 'S': seed = strtoull(optarg, NULL, 10); break;
+        case 'a': base = strtoull(optarg, NULL, 16); break;
+        case 'o': outname = optarg; break;
+        case 'h':
+            usage(argv);
+            exit(0);
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+
+    if (pattern == NULL || n <= 0 || w <= 0 || k <= 0 || footprint < w ||
+        passes <= 0 || tile <= 0) {
+        usage(argv);
+        exit(1);
+    }
+
+    out = stdout;
+    if (outname && (out = fopen(outname, "w")) == NULL) {
+        perror(outname);
+        exit(1);
+    }
+
+    if (strcmp(pattern, "seq") == 0)
+        gen_seq();
+    else if (strcmp(pattern, "stride") == 0)
+        gen_stride();
+    else if (strcmp(pattern, "uniform") == 0)
+        gen_uniform();
+    else if (strcmp(pattern, "zipf") == 0)
+        gen_zipf();
+    else if (strcmp(pattern, "chase") == 0)
+        gen_chase();
+    else if (strcmp(pattern, "blocked") == 0)
+        gen_blocked();
+    else {
+        fprintf(stderr, "patgen: unknown pattern %s\n", pattern);
+        exit(1);
+    }
+
+    if (out != stdout)
+        fclose(out);
+    return 0;
+}
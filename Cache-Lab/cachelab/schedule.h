@@ -0,0 +1,214 @@
+/*
+ * schedule.h - The tile schedules of trans_1 and trans_2 as macros, so
+ *     that kernels which do more than copy each element follow them
+ *     access for access
+ *
+ * SCHED_KERNELS(name, btype, OP) defines three static functions:
+ *
+ *   name_strips(th, tw, M, N, A, B, c)   th x tw tiles, a row of A at a
+ *                                        time (trans_1)
+ *   name_square(tw, M, N, A, B, c, i, j) the tw x tw tile at (i, j)
+ *                                        split into quadrants, the
+ *                                        top-right one parked in B until
+ *                                        it can be moved (trans_2)
+ *   name_squares(th, tw, M, N, A, B, c)  every tile by name_square;
+ *                                        shapes tw does not divide use
+ *                                        name_strips
+ *
+ * SCHED_SQUARE_TILES(name, btype, OP) defines only name_square, for
+ * tile.c. SCHED_ROWS(name, W) defines a plain int copy of a block at
+ * most W wide, a row of A at a time:
+ *
+ *   name_rows_wW(M, N, A, B, i0, i1, j0, j1)   rows [i0,i1) x columns
+ *                                               [j0,j1) of A
+ *
+ * OP(v, r, c) is the value stored to B[r][c] when element v of A gets
+ * there; it may read the kernels' last argument, c. Parked elements are
+ * stored as btype and finished by OP when they are moved. A tile row is
+ * held in named temporaries t0, t1, ... rather than an array, as the
+ * lab asks of trans.c, so each schedule is expanded once per width.
+ */
+
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include "tile.h"
+
+/* Widths are expanded up to TILE_MAX_WIDTH, the widest tileForCache
+   returns */
+
+/* X(n, a) for each temporary of a tile row of width W */
+#define SCHED_EACH_1(X, a)  X(0, a)
+#define SCHED_EACH_2(X, a)  SCHED_EACH_1(X, a) X(1, a)
+#define SCHED_EACH_4(X, a)  SCHED_EACH_2(X, a) X(2, a) X(3, a)
+#define SCHED_EACH_8(X, a)  SCHED_EACH_4(X, a) X(4, a) X(5, a) X(6, a) X(7, a)
+#define SCHED_EACH_16(X, a) SCHED_EACH_8(X, a) X(8, a) X(9, a) X(10, a) \
+                            X(11, a) X(12, a) X(13, a) X(14, a) X(15, a)
+#define SCHED_EACH_32(X, a) SCHED_EACH_16(X, a) X(16, a) X(17, a) X(18, a) \
+                            X(19, a) X(20, a) X(21, a) X(22, a) X(23, a) \
+                            X(24, a) X(25, a) X(26, a) X(27, a) X(28, a) \
+                            X(29, a) X(30, a) X(31, a)
+
+/* X(n, n + W/2, a) for each temporary of the left half of a tile row */
+#define SCHED_HALF_2(X, a)  X(0, 1, a)
+#define SCHED_HALF_4(X, a)  X(0, 2, a) X(1, 3, a)
+#define SCHED_HALF_8(X, a)  X(0, 4, a) X(1, 5, a) X(2, 6, a) X(3, 7, a)
+#define SCHED_HALF_16(X, a) X(0, 8, a) X(1, 9, a) X(2, 10, a) X(3, 11, a) \
+                            X(4, 12, a) X(5, 13, a) X(6, 14, a) X(7, 15, a)
+#define SCHED_HALF_32(X, a) X(0, 16, a) X(1, 17, a) X(2, 18, a) X(3, 19, a) \
+                            X(4, 20, a) X(5, 21, a) X(6, 22, a) X(7, 23, a) \
+                            X(8, 24, a) X(9, 25, a) X(10, 26, a) X(11, 27, a) \
+                            X(12, 28, a) X(13, 29, a) X(14, 30, a) X(15, 31, a)
+
+#define SCHED_DECL(n, a) int t##n;
+
+/*
+ * name_strips_w<W> - th x W tiles. Each tile row of A is loaded into the
+ *     temporaries and then stored down a column of B; the last strip is
+ *     clipped to the matrix when W does not divide M.
+ */
+#define SCHED_STRIP_LOAD(n, a)          t##n = A[k][j + n];
+#define SCHED_STRIP_STORE(n, OP)        B[j + n][k] = OP(t##n, j + n, k);
+#define SCHED_STRIP_LOAD_CLIPPED(n, a)  if (j + n < M) t##n = A[k][j + n];
+#define SCHED_STRIP_STORE_CLIPPED(n, OP) \
+    if (j + n < M) B[j + n][k] = OP(t##n, j + n, k);
+
+#define SCHED_STRIPS(name, W, btype, OP) \
+static void name##_strips_w##W(int th, int M, int N, const int A[N][M], \
+                               btype B[M][N], const int *c) \
+{ \
+    int i, j, k; \
+    SCHED_EACH_##W(SCHED_DECL, 0) \
+    for (j = 0; j < M; j += W) { \
+        for (i = 0; i < N; i += th) { \
+            for (k = i; k < i + th && k < N; k++) { \
+                if (j + W <= M) { \
+                    SCHED_EACH_##W(SCHED_STRIP_LOAD, 0) \
+                    SCHED_EACH_##W(SCHED_STRIP_STORE, OP) \
+                } else { \
+                    SCHED_EACH_##W(SCHED_STRIP_LOAD_CLIPPED, 0) \
+                    SCHED_EACH_##W(SCHED_STRIP_STORE_CLIPPED, OP) \
+                } \
+            } \
+        } \
+    } \
+}
+
+/*
+ * name_rows_w<W> - Each row of the block is loaded into the temporaries
+ *     and then stored down a column of B; those past j1 are unused, and
+ *     zeroed only so that the compiler can see they are set.
+ */
+#define SCHED_ROW_LOAD(n, a)  if (j0 + n < j1) t##n = A[i][j0 + n];
+#define SCHED_ROW_STORE(n, a) if (j0 + n < j1) B[j0 + n][i] = t##n;
+#define SCHED_ROW_DECL(n, a)  int t##n = 0;
+
+#define SCHED_ROWS(name, W) \
+static void name##_rows_w##W(int M, int N, int A[N][M], int B[M][N], \
+                             int i0, int i1, int j0, int j1) \
+{ \
+    int i; \
+    SCHED_EACH_##W(SCHED_ROW_DECL, 0) \
+    for (i = i0; i < i1; i++) { \
+        SCHED_EACH_##W(SCHED_ROW_LOAD, 0) \
+        SCHED_EACH_##W(SCHED_ROW_STORE, 0) \
+    } \
+}
+
+/*
+ * name_square_w<W> - The W x W tile at (i, j) in quadrants of W/2. The
+ *     top-right quadrant of A is parked in the top-right of B and moved
+ *     to the bottom-left while the bottom-left of A is stored.
+ *     t0..t(W/2-1) only hold elements of A; the rest also hold parked
+ *     ones, as btype.
+ */
+#define SCHED_DECL_PAIR(x, y, btype)     int t##x; btype t##y;
+#define SCHED_LOAD_TOP(n, a)             t##n = A[i + k][j + n];
+#define SCHED_STORE_LEFT(x, y, OP)       B[j + x][i + k] = OP(t##x, j + x, i + k);
+#define SCHED_STORE_PARKED(x, y, a)      B[j + x][i + k + (y - x)] = t##y;
+#define SCHED_LOAD_LEFT(x, y, a)         t##x = A[i + y][j + k];
+#define SCHED_LOAD_PARKED(x, y, a)       t##y = B[j + k][i + y];
+#define SCHED_STORE_RIGHT(x, y, OP)      B[j + k][i + y] = OP(t##x, j + k, i + y);
+#define SCHED_STORE_MOVED(x, y, OP) \
+    B[j + k + (y - x)][i + x] = OP(t##y, j + k + (y - x), i + x);
+#define SCHED_LOAD_BOTTOM(x, y, a)       t##x = A[i + k][j + y];
+#define SCHED_STORE_BOTTOM(x, y, OP)     B[j + y][i + k] = OP(t##x, j + y, i + k);
+
+#define SCHED_SQUARE(name, W, btype, OP) \
+static void name##_square_w##W(int M, int N, const int A[N][M], \
+                               btype B[M][N], const int *c, int i, int j) \
+{ \
+    int k; \
+    SCHED_HALF_##W(SCHED_DECL_PAIR, btype) \
+    /* Top half of A: left quadrant to its place, right one parked */ \
+    for (k = 0; k < (W) / 2; k++) { \
+        SCHED_EACH_##W(SCHED_LOAD_TOP, 0) \
+        SCHED_HALF_##W(SCHED_STORE_LEFT, OP) \
+        SCHED_HALF_##W(SCHED_STORE_PARKED, 0) \
+    } \
+    /* Bottom-left of A in, parked quadrant down to the bottom-left */ \
+    for (k = 0; k < (W) / 2; k++) { \
+        SCHED_HALF_##W(SCHED_LOAD_LEFT, 0) \
+        SCHED_HALF_##W(SCHED_LOAD_PARKED, 0) \
+        SCHED_HALF_##W(SCHED_STORE_RIGHT, OP) \
+        SCHED_HALF_##W(SCHED_STORE_MOVED, OP) \
+    } \
+    /* Bottom-right quadrant */ \
+    for (k = (W) / 2; k < (W); k++) { \
+        SCHED_HALF_##W(SCHED_LOAD_BOTTOM, 0) \
+        SCHED_HALF_##W(SCHED_STORE_BOTTOM, OP) \
+    } \
+}
+
+#define SCHED_SQUARE_TILES(name, btype, OP) \
+SCHED_SQUARE(name, 2, btype, OP) \
+SCHED_SQUARE(name, 4, btype, OP) \
+SCHED_SQUARE(name, 8, btype, OP) \
+SCHED_SQUARE(name, 16, btype, OP) \
+SCHED_SQUARE(name, 32, btype, OP) \
+static void name##_square(int tw, int M, int N, const int A[N][M], \
+                          btype B[M][N], const int *c, int i, int j) \
+{ \
+    switch (tw) { \
+    case 2:  name##_square_w2(M, N, A, B, c, i, j); break; \
+    case 4:  name##_square_w4(M, N, A, B, c, i, j); break; \
+    case 8:  name##_square_w8(M, N, A, B, c, i, j); break; \
+    case 16: name##_square_w16(M, N, A, B, c, i, j); break; \
+    default: name##_square_w32(M, N, A, B, c, i, j); break; \
+    } \
+}
+
+#define SCHED_KERNELS(name, btype, OP) \
+SCHED_STRIPS(name, 1, btype, OP) \
+SCHED_STRIPS(name, 2, btype, OP) \
+SCHED_STRIPS(name, 4, btype, OP) \
+SCHED_STRIPS(name, 8, btype, OP) \
+SCHED_STRIPS(name, 16, btype, OP) \
+SCHED_STRIPS(name, 32, btype, OP) \
+SCHED_SQUARE_TILES(name, btype, OP) \
+static void name##_strips(int th, int tw, int M, int N, const int A[N][M], \
+                          btype B[M][N], const int *c) \
+{ \
+    switch (tw) { \
+    case 1:  name##_strips_w1(th, M, N, A, B, c); break; \
+    case 2:  name##_strips_w2(th, M, N, A, B, c); break; \
+    case 4:  name##_strips_w4(th, M, N, A, B, c); break; \
+    case 8:  name##_strips_w8(th, M, N, A, B, c); break; \
+    case 16: name##_strips_w16(th, M, N, A, B, c); break; \
+    default: name##_strips_w32(th, M, N, A, B, c); break; \
+    } \
+} \
+static void name##_squares(int th, int tw, int M, int N, const int A[N][M], \
+                           btype B[M][N], const int *c) \
+{ \
+    int i, j; \
+    if (tw < 2 || M % tw != 0 || N % tw != 0) { \
+        name##_strips(th, tw, M, N, A, B, c); \
+        return; \
+    } \
+    for (i = 0; i < N; i += tw) \
+        for (j = 0; j < M; j += tw) \
+            name##_square(tw, M, N, A, B, c, i, j); \
+}
+
+#endif /* SCHEDULE_H */
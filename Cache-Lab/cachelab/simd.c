@@ -0,0 +1,297 @@
+/*
+ * simd.c - SIMD transpose kernels. Compiled twice like tile.c; only the
+ *     kernels go into the TRACE_BUILD copy. Each vector kernel is built
+ *     for its own instruction set with a target attribute, so the file
+ *     needs no -m flags and runs on any x86-64 CPU.
+ */
+#include <string.h>
+#include <pthread.h>
+#include "simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_X86 1
+#include <immintrin.h>
+#else
+#define HAVE_X86 0
+#endif
+
+/* A kernel transposes one w x w tile from src (rows sstride ints apart)
+   to dst (rows dstride ints apart) */
+typedef void (*kernel_t)(const int *src, int sstride, int *dst, int dstride);
+
+/*
+ * kernel_scalar - 8x8 tile, a row of A at a time through locals
+ */
+static void kernel_scalar(const int *src, int sstride, int *dst, int dstride)
+{
+    int i, j, row[8];
+
+    for (i = 0; i < 8; i++) {
+        for (j = 0; j < 8; j++)
+            row[j] = src[i * sstride + j];
+        for (j = 0; j < 8; j++)
+            dst[j * dstride + i] = row[j];
+    }
+}
+
+#if HAVE_X86
+
+/*
+ * kernel_sse2 - 4x4 tile: interleave pairs of rows 32 bits at a time,
+ *     then 64 bits at a time
+ */
+__attribute__((target("sse2")))
+static void kernel_sse2(const int *src, int sstride, int *dst, int dstride)
+{
+    __m128i r0 = _mm_loadu_si128((const __m128i *)(src + 0 * sstride));
+    __m128i r1 = _mm_loadu_si128((const __m128i *)(src + 1 * sstride));
+    __m128i r2 = _mm_loadu_si128((const __m128i *)(src + 2 * sstride));
+    __m128i r3 = _mm_loadu_si128((const __m128i *)(src + 3 * sstride));
+
+    __m128i t0 = _mm_unpacklo_epi32(r0, r1);   /* a0 b0 a1 b1 */
+    __m128i t1 = _mm_unpacklo_epi32(r2, r3);   /* c0 d0 c1 d1 */
+    __m128i t2 = _mm_unpackhi_epi32(r0, r1);   /* a2 b2 a3 b3 */
+    __m128i t3 = _mm_unpackhi_epi32(r2, r3);   /* c2 d2 c3 d3 */
+
+    _mm_storeu_si128((__m128i *)(dst + 0 * dstride), _mm_unpacklo_epi64(t0, t1));
+    _mm_storeu_si128((__m128i *)(dst + 1 * dstride), _mm_unpackhi_epi64(t0, t1));
+    _mm_storeu_si128((__m128i *)(dst + 2 * dstride), _mm_unpacklo_epi64(t2, t3));
+    _mm_storeu_si128((__m128i *)(dst + 3 * dstride), _mm_unpackhi_epi64(t2, t3));
+}
+
+/*
+ * kernel_avx2 - 8x8 tile: the 4x4 steps run in both 128-bit lanes at
+ *     once, and a final cross-lane permute joins the halves of each
+ *     column
+ */
+__attribute__((target("avx2")))
+static void kernel_avx2(const int *src, int sstride, int *dst, int dstride)
+{
+    __m256i r0 = _mm256_loadu_si256((const __m256i *)(src + 0 * sstride));
+    __m256i r1 = _mm256_loadu_si256((const __m256i *)(src + 1 * sstride));
+    __m256i r2 = _mm256_loadu_si256((const __m256i *)(src + 2 * sstride));
+    __m256i r3 = _mm256_loadu_si256((const __m256i *)(src + 3 * sstride));
+    __m256i r4 = _mm256_loadu_si256((const __m256i *)(src + 4 * sstride));
+    __m256i r5 = _mm256_loadu_si256((const __m256i *)(src + 5 * sstride));
+    __m256i r6 = _mm256_loadu_si256((const __m256i *)(src + 6 * sstride));
+    __m256i r7 = _mm256_loadu_si256((const __m256i *)(src + 7 * sstride));
+
+    __m256i t0 = _mm256_unpacklo_epi32(r0, r1);
+    __m256i t1 = _mm256_unpackhi_epi32(r0, r1);
+    __m256i t2 = _mm256_unpacklo_epi32(r2, r3);
+    __m256i t3 = _mm256_unpackhi_epi32(r2, r3);
+    __m256i t4 = _mm256_unpacklo_epi32(r4, r5);
+    __m256i t5 = _mm256_unpackhi_epi32(r4, r5);
+    __m256i t6 = _mm256_unpacklo_epi32(r6, r7);
+    __m256i t7 = _mm256_unpackhi_epi32(r6, r7);
+
+    /* u0 holds column 0 of rows 0-3 in its low lane and column 4 in its high lane */
+    __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+    __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+    __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+    __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+    _mm256_storeu_si256((__m256i *)(dst + 0 * dstride), _mm256_permute2x128_si256(u0, u4, 0x20));
+    _mm256_storeu_si256((__m256i *)(dst + 1 * dstride), _mm256_permute2x128_si256(u1, u5, 0x20));
+    _mm256_storeu_si256((__m256i *)(dst + 2 * dstride), _mm256_permute2x128_si256(u2, u6, 0x20));
+    _mm256_storeu_si256((__m256i *)(dst + 3 * dstride), _mm256_permute2x128_si256(u3, u7, 0x20));
+    _mm256_storeu_si256((__m256i *)(dst + 4 * dstride), _mm256_permute2x128_si256(u0, u4, 0x31));
+    _mm256_storeu_si256((__m256i *)(dst + 5 * dstride), _mm256_permute2x128_si256(u1, u5, 0x31));
+    _mm256_storeu_si256((__m256i *)(dst + 6 * dstride), _mm256_permute2x128_si256(u2, u6, 0x31));
+    _mm256_storeu_si256((__m256i *)(dst + 7 * dstride), _mm256_permute2x128_si256(u3, u7, 0x31));
+}
+
+/*
+ * kernel_batch4_avx2 - Two consecutive 4x4 matrices at once, one in each
+ *     128-bit lane: row r of both is gathered into one register, the
+ *     4x4 steps of kernel_sse2 run in both lanes, and the lanes are
+ *     split again on the way out
+ */
+__attribute__((target("avx2")))
+static void kernel_batch4_avx2(const int *src, int *dst)
+{
+    __m256i a01 = _mm256_loadu_si256((const __m256i *)(src + 0));
+    __m256i a23 = _mm256_loadu_si256((const __m256i *)(src + 8));
+    __m256i b01 = _mm256_loadu_si256((const __m256i *)(src + 16));
+    __m256i b23 = _mm256_loadu_si256((const __m256i *)(src + 24));
+
+    /* r<k> holds row k of the first matrix in its low lane, of the second in its high lane */
+    __m256i r0 = _mm256_permute2x128_si256(a01, b01, 0x20);
+    __m256i r1 = _mm256_permute2x128_si256(a01, b01, 0x31);
+    __m256i r2 = _mm256_permute2x128_si256(a23, b23, 0x20);
+    __m256i r3 = _mm256_permute2x128_si256(a23, b23, 0x31);
+
+    __m256i t0 = _mm256_unpacklo_epi32(r0, r1);
+    __m256i t1 = _mm256_unpacklo_epi32(r2, r3);
+    __m256i t2 = _mm256_unpackhi_epi32(r0, r1);
+    __m256i t3 = _mm256_unpackhi_epi32(r2, r3);
+
+    __m256i c0 = _mm256_unpacklo_epi64(t0, t1);
+    __m256i c1 = _mm256_unpackhi_epi64(t0, t1);
+    __m256i c2 = _mm256_unpacklo_epi64(t2, t3);
+    __m256i c3 = _mm256_unpackhi_epi64(t2, t3);
+
+    _mm256_storeu_si256((__m256i *)(dst + 0), _mm256_permute2x128_si256(c0, c1, 0x20));
+    _mm256_storeu_si256((__m256i *)(dst + 8), _mm256_permute2x128_si256(c2, c3, 0x20));
+    _mm256_storeu_si256((__m256i *)(dst + 16), _mm256_permute2x128_si256(c0, c1, 0x31));
+    _mm256_storeu_si256((__m256i *)(dst + 24), _mm256_permute2x128_si256(c2, c3, 0x31));
+}
+
+#endif /* HAVE_X86 */
+
+/*
+ * transpose_tiles - One N x M matrix at src into dst with the given
+ *     w x w kernel, and its ragged edges one element at a time
+ */
+static void transpose_tiles(kernel_t kernel, int w, int M, int N, const int *src, int *dst)
+{
+    int i, j, ifull = N - N % w, jfull = M - M % w;
+
+    for (i = 0; i < ifull; i += w)
+        for (j = 0; j < jfull; j += w)
+            kernel(src + i * M + j, M, dst + j * N + i, N);
+    for (i = 0; i < ifull; i++)
+        for (j = jfull; j < M; j++)
+            dst[j * N + i] = src[i * M + j];
+    for (i = ifull; i < N; i++)
+        for (j = 0; j < M; j++)
+            dst[j * N + i] = src[i * M + j];
+}
+
+/*
+ * simdTransposeBatch - The level and kernel are chosen once for the
+ *     whole batch. Pairs of 4x4 matrices share AVX2 registers; other
+ *     shapes go through the widest kernel whose tile fits the matrix,
+ *     one matrix after another so that both arrays stream through the
+ *     cache in order.
+ */
+void simdTransposeBatch(int M, int N, int count, const int *A, int *B)
+{
+    int level = simdLevel(), w = 8, k;
+    long size = (long)M * N;
+    kernel_t kernel = kernel_scalar;
+
+#if HAVE_X86
+    if (level == SIMD_AVX2 && M == 4 && N == 4) {
+        for (k = 0; k + 1 < count; k += 2)
+            kernel_batch4_avx2(A + k * size, B + k * size);
+        if (k < count)
+            kernel_sse2(A + k * size, 4, B + k * size, 4);
+        return;
+    }
+    if (level == SIMD_AVX2 && M >= 8 && N >= 8) {
+        kernel = kernel_avx2;
+    } else if (level >= SIMD_SSE2) {
+        kernel = kernel_sse2;
+        w = 4;
+    }
+#else
+    (void)level;
+#endif
+
+    for (k = 0; k < count; k++)
+        transpose_tiles(kernel, w, M, N, A + k * size, B + k * size);
+}
+
+/*
+ * simdTransposeRect - Transpose whole w x w tiles of rows [i0,i1) x
+ *     columns [j0,j1) with the kernel for the current level, then the
+ *     columns and rows left over on the right and bottom one element at
+ *     a time
+ */
+void simdTransposeRect(int M, int N, int A[N][M], int B[M][N],
+                       int i0, int i1, int j0, int j1)
+{
+    int level = simdLevel(), w = 8, i, j, ifull, jfull;
+    kernel_t kernel = kernel_scalar;
+
+#if HAVE_X86
+    if (level == SIMD_AVX2) {
+        kernel = kernel_avx2;
+    } else if (level == SIMD_SSE2) {
+        kernel = kernel_sse2;
+        w = 4;
+    }
+#else
+    (void)level;
+#endif
+
+    ifull = i1 - (i1 - i0) % w;
+    jfull = j1 - (j1 - j0) % w;
+    for (i = i0; i < ifull; i += w)
+        for (j = j0; j < jfull; j += w)
+            kernel(&A[i][j], M, &B[j][i], N);
+
+    for (i = i0; i < ifull; i++)
+        for (j = jfull; j < j1; j++)
+            B[j][i] = A[i][j];
+    for (i = ifull; i < i1; i++)
+        for (j = j0; j < j1; j++)
+            B[j][i] = A[i][j];
+}
+
+/*
+ * simdTranspose - The whole matrix
+ */
+void simdTranspose(int M, int N, int A[N][M], int B[M][N])
+{
+    simdTransposeRect(M, N, A, B, 0, N, 0, M);
+}
+
+#ifndef TRACE_BUILD
+
+static const char *level_names[] = {"scalar", "sse2", "avx2"};
+
+/* Detected once, on first use from any thread */
+static int current_level = SIMD_SCALAR;
+static pthread_once_t level_once = PTHREAD_ONCE_INIT;
+
+/*
+ * detect_level - Set current_level to the best level this CPU supports
+ */
+static void detect_level(void)
+{
+#if HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        current_level = SIMD_AVX2;
+    else if (__builtin_cpu_supports("sse2"))
+        current_level = SIMD_SSE2;
+#endif
+}
+
+int simdLevel(void)
+{
+    pthread_once(&level_once, detect_level);
+    return current_level;
+}
+
+int simdLimitLevel(int level)
+{
+    if (level < simdLevel())
+        current_level = level < SIMD_SCALAR ? SIMD_SCALAR : level;
+    return current_level;
+}
+
+const char *simdLevelName(int level)
+{
+    if (level < SIMD_SCALAR || level > SIMD_AVX2)
+        return "unknown";
+    return level_names[level];
+}
+
+int simdParseLevel(const char *name)
+{
+    int level;
+
+    for (level = SIMD_SCALAR; level <= SIMD_AVX2; level++)
+        if (strcmp(name, level_names[level]) == 0)
+            return level;
+    return -1;
+}
+
+#endif /* TRACE_BUILD */
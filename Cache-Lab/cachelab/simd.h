@@ -0,0 +1,58 @@
+/*
+ * simd.h - SIMD transpose kernels with runtime CPU dispatch
+ *
+ * Square tiles are transposed in vector registers with unpack and
+ * permute instructions: 8x8 with AVX2, 4x4 with SSE2, and a scalar 8x8
+ * loop on CPUs (or builds) with neither. The best level the CPU
+ * supports is picked on first use and can be lowered for comparisons.
+ */
+
+#ifndef SIMD_H
+#define SIMD_H
+
+/* Instruction set levels, in increasing order */
+#define SIMD_SCALAR 0
+#define SIMD_SSE2   1
+#define SIMD_AVX2   2
+
+/* The level simdTranspose uses */
+int simdLevel(void);
+
+/* Use at most this level from now on. Returns the level in effect. Call
+   it before starting threads that transpose; simdLevel itself is safe
+   to call from any thread. */
+int simdLimitLevel(int level);
+
+/* "scalar", "sse2" or "avx2" */
+const char *simdLevelName(int level);
+
+/* Parse a level name. Returns -1 if unknown. */
+int simdParseLevel(const char *name);
+
+/* B = A^T, whole tiles in registers and the ragged edges in scalar code */
+void simdTranspose(int M, int N, int A[N][M], int B[M][N]);
+
+/* Transpose only rows [i0,i1) x columns [j0,j1) of A */
+void simdTransposeRect(int M, int N, int A[N][M], int B[M][N],
+                       int i0, int i1, int j0, int j1);
+
+/*
+ * B[k] = A[k]^T for count matrices of N rows x M ints stored back to
+ * back in A, with the transposes stored back to back in B. Meant for
+ * many tiny matrices (4x4 to 32x32), where a call per matrix would cost
+ * more than the transpose itself.
+ */
+void simdTransposeBatch(int M, int N, int count, const int *A, int *B);
+
+/* The instrumented build, named apart as in tile.h */
+void simdTransposeTraced(int M, int N, int A[N][M], int B[M][N]);
+void simdTransposeRectTraced(int M, int N, int A[N][M], int B[M][N],
+                             int i0, int i1, int j0, int j1);
+void simdTransposeBatchTraced(int M, int N, int count, const int *A, int *B);
+#ifdef TRACE_BUILD
+#define simdTranspose simdTransposeTraced
+#define simdTransposeRect simdTransposeRectTraced
+#define simdTransposeBatch simdTransposeBatchTraced
+#endif
+
+#endif /* SIMD_H */
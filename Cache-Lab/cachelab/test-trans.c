@@ -3,6 +3,7 @@
  *     student's transpose functions and records the results for their
  *     official submitted version as well.
  */
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -10,8 +11,11 @@
 #include <string.h>
 #include <signal.h>
 #include <getopt.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include "cachelab.h"
+#include "cachesim.h"
+#include "memtrace.h"
 #include <sys/wait.h> // fir WEXITSTATUS
 #include <limits.h> // for INT_MAX
 
@@ -25,6 +29,15 @@
 /* External function defined in trans.c */
 extern void registerFunctions();
 
+/* External function defined in transtype.c */
+extern void registerTypedFunctions(void);
+
+/* External function defined in fused.c */
+extern void registerFusedFunctions(void);
+
+/* External function defined in kernels.c */
+extern void registerKernelFunctions(void);
+
 /* External variables defined in cachelab-tools.c */
 extern trans_func_t func_list[MAX_TRANS_FUNCS];
 extern int func_counter; 
@@ -32,6 +45,7 @@ extern int func_counter;
 /* Globals set on the command line */
 static int M = 0;
 static int N = 0;
+static int use_valgrind = 0;
 
 /* The correctness and performance for the submitted transpose function */
 struct results {
@@ -41,135 +55,520 @@ struct results {
 };
 static struct results results = {-1, 0, INT_MAX};
 
+/* Cache geometries each function is evaluated on. The first one is
+   the official target (-s/-E/-b): the functions are tuned for it and
+   its misses are reported for the submission. */
+#define MAX_TARGETS 8
+static struct {
+    unsigned int s, E, b;
+} targets[MAX_TARGETS] = {{5, 1, 5}};
+static int num_targets = 1;
+
+/* Worker threads; 0 means one per online CPU */
+static int num_workers = 0;
+
+/* Element types whose typed functions are evaluated (-t) */
+static int typed_selected[NUM_ELEM_TYPES];
+
+/* Whether to evaluate the fused functions (-f) */
+static int use_fused = 0;
+
+/* Kernel classes whose kernels are evaluated (-k), by index into
+   kernel_classes */
+static int kernel_selected[MAX_TRANS_FUNCS];
+
+/* Jobs evaluated of each kind (FUNC_*) */
+static int num_kind_jobs[FUNC_KERNEL + 1];
+
+/* The outcome of evaluating one registered function on every target */
+typedef struct {
+    int index;                  /* the function in func_list */
+    int number;                 /* its number among functions of its kind */
+    int status;                 /* 0 if evaluated, -1 if it failed validation */
+    char error[256];            /* why it failed */
+    unsigned int hits[MAX_TARGETS];
+    unsigned int misses[MAX_TARGETS];
+    unsigned int evictions[MAX_TARGETS];
+} job_t;
+
+static job_t *jobs;
+static int num_jobs = 0, next_job = 0;
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /* 
- * eval_perf - Evaluate the performance of the registered transpose functions
+ * init_caches - Create one cache per target
  */
-void eval_perf(unsigned int s, unsigned int E, unsigned int b)
+static void init_caches(cache_t *caches)
 {
-    int i,flag;
-    unsigned int len, hits, misses, evictions;
-    unsigned long long int marker_start, marker_end, addr;
-    char buf[1000], cmd[255];
-    char filename[128];
+    int t;
+    for (t = 0; t < num_targets; t++) {
+        if (cacheInit(&caches[t], targets[t].s, targets[t].E, targets[t].b, POLICY_LRU) < 0) {
+            printf("Error: unsupported cache geometry\n");
+            exit(1);
+        }
+    }
+}
 
-    registerFunctions(); 
+/* 
+ * save_caches - Copy the counters of each target's cache into the job
+ */
+static void save_caches(cache_t *caches, job_t *job)
+{
+    int t;
+    for (t = 0; t < num_targets; t++) {
+        job->hits[t] = caches[t].hits;
+        job->misses[t] = caches[t].misses;
+        job->evictions[t] = caches[t].evictions;
+        cacheFree(&caches[t]);
+    }
+}
 
-    /* Open the complete trace file */
-    FILE* full_trace_fp;  
-    FILE* part_trace_fp; 
+/* 
+ * simulate_access - Simulate one recorded access on every target. A
+ *     vector access that straddles blocks touches each of them.
+ */
+static void simulate_access(cache_t *caches, unsigned long long int addr,
+                            int size, int write)
+{
+    unsigned long long int blk, last;
+    int t;
 
-    /* Evaluate the performance of each registered transpose function */
+    for (t = 0; t < num_targets; t++) {
+        last = (addr + size - 1) >> caches[t].b;
+        for (blk = addr >> caches[t].b; blk <= last; blk++)
+            cacheAccess(&caches[t], blk << caches[t].b, write, 0, NULL);
+    }
+}
 
-    for (i=0; i<func_counter; i++) {
-        if (strcmp(func_list[i].description, SUBMIT_DESCRIPTION) == 0 )
-            results.funcid = i; /* remember which function is the submission */
+/* 
+ * trace_inprocess - Run the function of a job from its instrumented
+ *     build on arrays private to the job, recording its accesses to them
+ *     in a per-thread buffer, and feed them straight into the cache
+ *     models. Each array its class describes gets the room of a MAXN x
+ *     MAXN matrix of its elements, so they lie apart as A and B do; the
+ *     arrays are page aligned and addresses are taken relative to them,
+ *     so every job sees the same cache layout no matter where its
+ *     arrays landed. The function's stack frame is not traced (see
+ *     trace_valgrind), so these counts are not comparable with -V ones.
+ *     Returns 0 on success and -1 if the class's check fails.
+ */
+static int trace_inprocess(job_t *job)
+{
+    trans_func_t *f = &func_list[job->index];
+    const func_class_t *cls = f->cls;
+    size_t size = elemSize(cls->elem), span = size * MAXN * MAXN;
+    void *arrays[MAX_FUNC_ARRAYS];
+    unsigned long long int base;
+    mem_access_t *trace;
+    cache_t caches[MAX_TARGETS];
+    char *mem;
+    int a, k, count;
+    long bad;
+
+    if (posix_memalign((void **)&mem, 4096, span * cls->num_arrays) != 0) {
+        printf("Error: out of memory\n");
+        exit(1);
+    }
+    base = (unsigned long long int)mem;
+    memtraceClearRegions();
+    for (a = 0; a < cls->num_arrays; a++) {
+        arrays[a] = mem + a * span;
+        assert(cls->array_len(a, M, N) <= MAXN * MAXN);
+        memtraceAddRegion(arrays[a], size * cls->array_len(a, M, N));
+    }
+    cls->init(M, N, arrays);
+
+    memtraceStart();
+    if (cls->kind == FUNC_TRANS)
+        (*f->func_ptr)(M, N, arrays[0], arrays[1]);
+    else
+        (*f->array_func)(M, N, arrays);
+    trace = memtraceStop(&count);
+
+    bad = cls->check(M, N, arrays);
+    free(mem);
+    if (bad >= 0) {
+        snprintf(job->error, sizeof(job->error),
+                 "Validation failed on %s function %d! Wrong value at %s[%ld]\n",
+                 cls->name, job->number, cls->array_names[cls->output], bad);
+        return -1;
+    }
 
+    init_caches(caches);
+    for (k = 0; k < count; k++)
+        simulate_access(caches, trace[k].addr - base, trace[k].size, trace[k].op == 'S');
+    save_caches(caches, job);
+    return 0;
+}
 
-        printf("\nFunction %d (%d total)\nStep 1: Validating and generating memory traces\n",i,func_counter);
-        /* Use valgrind to generate the trace */
+/* 
+ * trace_valgrind - Trace function i by running tracegen under valgrind's
+ *     lackey tool. The lackey output is read through a pipe as it is
+ *     produced: the region between the markers is picked out on the fly
+ *     and fed straight into the cache models, so nothing is written to
+ *     disk and memory use does not grow with the trace. Only accesses
+ *     inside the ranges tracegen announces (A, B and the function's own
+ *     stack frame) are simulated. This is the only path that counts the
+ *     frame, so its counts are higher than the in-process ones and not
+ *     comparable with them. tracegen is told the job's function by its
+ *     number among the transposes (-F) or the kernels (-K). Returns 0 on
+ *     success and -1 if the function failed validation.
+ */
+static int trace_valgrind(job_t *job)
+{
+    int kernel = func_list[job->index].cls->kind == FUNC_KERNEL;
+    int flag, have_markers, done, status, t;
+    unsigned int len;
+    unsigned long long int marker_start = 0, marker_end = 0, addr;
+    char buf[1000], cmd[255], name[MAX_RANGE_NAME];
+    range_map_t ranges = {NULL, 0};
+    cache_t caches[MAX_TARGETS];
+    FILE* lackey_fp;
+
+    init_caches(caches);
+
+    /* Use valgrind to generate the trace */
+    sprintf(cmd, "valgrind --tool=lackey --trace-mem=yes --log-fd=1 -v ./tracegen -M %d -N %d -%c %d -s %u -E %u -b %u",
+            M, N, kernel ? 'K' : 'F', job->number, targets[0].s, targets[0].E, targets[0].b);
+    lackey_fp = popen(cmd, "r");
+    assert(lackey_fp);
+
+    flag = have_markers = done = 0;
+    while (fgets(buf, 1000, lackey_fp) != NULL) {
+
+        /* tracegen announces the ranges it may touch and then the
+           marker addresses before it starts */
+        if (!have_markers) {
+            if (sscanf(buf, "RANGE %31s %llx %u", name, &addr, &len) == 3) {
+                addRange(&ranges, name, addr, len);
+            } else if (sscanf(buf, "MARKERS %llx %llx", &marker_start, &marker_end) == 2) {
+                have_markers = 1;
+                if (finishRangeMap(&ranges) < 0)
+                    exit(1);
+            }
+            continue;
+        }
 
-        sprintf(cmd, "valgrind --tool=lackey --trace-mem=yes --log-fd=1 -v ./tracegen -M %d -N %d -F %d  > trace.tmp", M, N,i);
-        flag=WEXITSTATUS(system(cmd));
-        if (0!=flag) {
-            printf("Validation error at function %d! Run ./tracegen -M %d -N %d -F %d for details.\nSkipping performance evaluation for this function.\n",flag-1,M,N,i);      
+        /* Past the end marker, just drain the pipe so that tracegen
+           can finish validating and report its exit status */
+        if (done)
             continue;
+
+        /* We are only interested in memory access instructions */
+        if (buf[0]==' ' && buf[2]==' ' &&
+            (buf[1]=='S' || buf[1]=='M' || buf[1]=='L' )) {
+            sscanf(buf+3, "%llx,%u", &addr, &len);
+        
+            /* If start marker found, set flag */
+            if (addr == marker_start)
+                flag = 1;
+
+            /* Valgrind creates many spurious accesses to the
+               stack that have nothing to do with the students
+               code, so only the matrices and the frame of the
+               function under test are simulated */
+            if (flag && findRange(&ranges, addr) >= 0) {
+                simulate_access(caches, addr, len, buf[1] != 'L');
+                if (buf[1] == 'M')
+                    for (t = 0; t < num_targets; t++)
+                        caches[t].hits++; /* the store half of a modify always hits */
+            }
+
+            /* if end marker found, stop simulating */
+            if (addr == marker_end)
+                done = 1;
         }
+    }
 
-        /* Get the start and end marker addresses */
-        FILE* marker_fp = fopen(".marker", "r");
-        assert(marker_fp);
-        fscanf(marker_fp, "%llx %llx", &marker_start, &marker_end);
-        fclose(marker_fp);
+    status = pclose(lackey_fp);
+    freeRangeMap(&ranges);
+    flag = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    if (0!=flag || !done) {
+        snprintf(job->error, sizeof(job->error),
+                 "Run ./tracegen -M %d -N %d -%c %d -s %u -E %u -b %u for details.\n",
+                 M, N, kernel ? 'K' : 'F', job->number, targets[0].s, targets[0].E, targets[0].b);
+        for (t = 0; t < num_targets; t++)
+            cacheFree(&caches[t]);
+        return -1;
+    }
 
+    save_caches(caches, job);
+    return 0;
+}
 
-        func_list[i].correct=1;
+/* 
+ * eval_worker - Evaluate registered functions until none are left
+ */
+static void *eval_worker(void *arg)
+{
+    job_t *job;
+    int i;
+
+    (void)arg;
+    for (;;) {
+        pthread_mutex_lock(&job_lock);
+        i = next_job++;
+        pthread_mutex_unlock(&job_lock);
+        if (i >= num_jobs)
+            break;
 
-        /* Save the correctness of the transpose submission */
-        if (results.funcid == i ) {
-            results.correct = 1;
+        job = &jobs[i];
+        job->status = use_valgrind ? trace_valgrind(job) : trace_inprocess(job);
+    }
+    memtraceFree();
+    return NULL;
+}
+
+/* 
+ * report_fused - Report the fused functions, which are not graded, and
+ *     how their misses compare with the two-pass equivalents
+ */
+static void report_fused(void)
+{
+    trans_func_t *f;
+    job_t *job, *other;
+    int i, k, t;
+
+    for (i = 0; i < num_jobs; i++) {
+        job = &jobs[i];
+        f = &func_list[job->index];
+        if (f->cls->kind != FUNC_FUSED)
+            continue;
+        printf("\nFused function %d [%s] (%d total)\nStep 1: Validating and generating memory traces\n",
+               job->number, f->cls->name, num_kind_jobs[FUNC_FUSED]);
+        if (job->status < 0) {
+            printf("%sSkipping performance evaluation for this function.\n", job->error);
+            continue;
         }
+        for (t = 0; t < num_targets; t++) {
+            printf("Step 2: Evaluating performance (s=%d, E=%d, b=%d)\n",
+                   targets[t].s, targets[t].E, targets[t].b);
+            printf("func %d [%s] (%s): hits:%u, misses:%u, evictions:%u\n",
+                   job->number, f->cls->name, f->description,
+                   job->hits[t], job->misses[t], job->evictions[t]);
+        }
+    }
 
-        full_trace_fp = fopen("trace.tmp", "r");
-        assert(full_trace_fp);
+    /* Each fused function against the two-pass one of the same class */
+    printf("\nFused vs two-pass misses\n");
+    for (i = 0; i < num_jobs; i++) {
+        job = &jobs[i];
+        f = &func_list[job->index];
+        if (f->cls->kind != FUNC_FUSED || f->baseline || job->status < 0)
+            continue;
+        for (k = 0; k < num_jobs; k++)
+            if (func_list[jobs[k].index].cls == f->cls && func_list[jobs[k].index].baseline)
+                break;
+        if (k == num_jobs || jobs[k].status < 0)
+            continue;
+        other = &jobs[k];
+        for (t = 0; t < num_targets; t++)
+            printf("%-9s (s=%d, E=%d, b=%d): fused %u, two-pass %u (%.2fx)\n",
+                   f->cls->name, targets[t].s, targets[t].E, targets[t].b,
+                   job->misses[t], other->misses[t],
+                   job->misses[t] ? (double)other->misses[t] / job->misses[t] : 0.0);
+    }
+}
 
+/* Whether the options select func_list[i] for evaluation */
+static int selected(int i)
+{
+    const func_class_t *cls = func_list[i].cls;
+    int c;
+
+    switch (cls->kind) {
+    case FUNC_TYPED:
+        return typed_selected[cls->elem];
+    case FUNC_FUSED:
+        return use_fused;
+    case FUNC_KERNEL:
+        for (c = 0; c < num_kernel_classes; c++)
+            if (cls == kernel_classes[c])
+                return kernel_selected[c];
+        return 0;
+    default:
+        return 1;
+    }
+}
 
-        /* Filtered trace for each transpose function goes in a separate file */
-        sprintf(filename, "trace.f%d", i);
-        part_trace_fp = fopen(filename, "w");
-        assert(part_trace_fp);
-    
-        /* Locate trace corresponding to the trans function */
-        flag = 0;
-        while (fgets(buf, 1000, full_trace_fp) != NULL) {
-
-            /* We are only interested in memory access instructions */
-            if (buf[0]==' ' && buf[2]==' ' &&
-                (buf[1]=='S' || buf[1]=='M' || buf[1]=='L' )) {
-                sscanf(buf+3, "%llx,%u", &addr, &len);
-        
-                /* If start marker found, set flag */
-                if (addr == marker_start)
-                    flag = 1;
-
-                /* Valgrind creates many spurious accesses to the
-                   stack that have nothing to do with the students
-                   code. At the moment, we are ignoring all stack
-                   accesses by using the simple filter of recording
-                   accesses to only the low 32-bit portion of the
-                   address space. At some point it would be nice to
-                   try to do more informed filtering so that would
-                   eliminate the valgrind stack references while
-                   include the student stack references. */
-                if (flag && addr < 0xffffffff) {
-                    fputs(buf, part_trace_fp);
-                }
-
-                /* if end marker found, close trace file */
-                if (addr == marker_end) {
-                    flag = 0;
-                    fclose(part_trace_fp);
-                    break;
-                }
-            }
+/* 
+ * eval_perf - Evaluate the performance of the registered functions on
+ *     every target. Functions are evaluated concurrently on a pool of
+ *     worker threads and reported afterwards in order.
+ */
+void eval_perf(void)
+{
+    int i, t, th, tw, workers;
+    char label[128];
+    int numbers[FUNC_KERNEL + 1] = {0};
+    pthread_t *tids;
+    trans_func_t *f;
+    job_t *job;
+
+    registerFunctions(); 
+    registerTypedFunctions();
+    registerFusedFunctions();
+    registerKernelFunctions();
+
+    /* The job list: the selected functions in registration order, each
+       numbered among all functions of its kind */
+    jobs = calloc(func_counter + 1, sizeof(job_t));
+    assert(jobs);
+    for (i = 0; i < func_counter; i++) {
+        int kind = func_list[i].cls->kind;
+        if (selected(i)) {
+            jobs[num_jobs].index = i;
+            jobs[num_jobs].number = numbers[kind];
+            num_jobs++;
+            num_kind_jobs[kind]++;
+        }
+        numbers[kind]++;
+    }
+
+    workers = num_workers ? num_workers : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (workers > num_jobs)
+        workers = num_jobs > 0 ? num_jobs : 1;
+
+    tids = malloc(workers * sizeof(pthread_t));
+    assert(tids);
+    for (i = 0; i < workers; i++) {
+        if (pthread_create(&tids[i], NULL, eval_worker, NULL) != 0) {
+            fprintf(stderr, "Unable to start worker thread\n");
+            exit(1);
+        }
+    }
+    for (i = 0; i < workers; i++)
+        pthread_join(tids[i], NULL);
+    free(tids);
+
+    /* Report the performance of each registered transpose function,
+       numbered among the transposes */
+
+    for (i = 0; i < num_jobs; i++) {
+        job = &jobs[i];
+        f = &func_list[job->index];
+        if (f->cls->kind != FUNC_TRANS)
+            continue;
+        if (strcmp(f->description, SUBMIT_DESCRIPTION) == 0 )
+            results.funcid = job->number; /* remember which function is the submission */
+
+
+        printf("\nFunction %d (%d total)\nStep 1: Validating and generating memory traces\n",job->number,num_kind_jobs[FUNC_TRANS]);
+        if (job->status < 0) {
+            if (use_valgrind)
+                printf("Validation error at function %d! %s", job->number, job->error);
+            else
+                printf("%sValidation error at function %d!\n", job->error, job->number);
+            printf("Skipping performance evaluation for this function.\n");
+            continue;
+        }
+
+        f->correct=1;
+
+        /* Save the correctness of the transpose submission */
+        if (results.funcid == job->number ) {
+            results.correct = 1;
+        }
+
+        f->num_hits = job->hits[0];
+        f->num_misses = job->misses[0];
+        f->num_evictions = job->evictions[0];
+        for (t = 0; t < num_targets; t++) {
+            printf("Step 2: Evaluating performance (s=%d, E=%d, b=%d)\n",
+                   targets[t].s, targets[t].E, targets[t].b);
+            printf("func %u (%s): hits:%u, misses:%u, evictions:%u\n",
+                   job->number, f->description, job->hits[t], job->misses[t],
+                   job->evictions[t]);
         }
-        fclose(full_trace_fp);
-
-        /* Run the reference simulator */
-        printf("Step 2: Evaluating performance (s=%d, E=%d, b=%d)\n", s, E, b);
-        char cmd[255];
-        sprintf(cmd, "./csim-ref -s %u -E %u -b %u -t trace.f%d > /dev/null", 
-                s, E, b, i);
-        system(cmd);
-    
-        /* Collect results from the reference simulator */
-        FILE* in_fp = fopen(".csim_results","r");
-        assert(in_fp);
-        fscanf(in_fp, "%u %u %u", &hits, &misses, &evictions);
-        fclose(in_fp);
-        func_list[i].num_hits = hits;
-        func_list[i].num_misses = misses;
-        func_list[i].num_evictions = evictions;
-        printf("func %u (%s): hits:%u, misses:%u, evictions:%u\n",
-               i, func_list[i].description, hits, misses, evictions);
     
         /* If it is transpose_submit(), record number of misses */
-        if (results.funcid == i) {
-            results.misses = misses;
+        if (results.funcid == job->number) {
+            results.misses = job->misses[0];
         }
     }
-  
+
+    /* Report the typed functions, which are not graded */
+    for (i = 0; i < num_jobs; i++) {
+        job = &jobs[i];
+        f = &func_list[job->index];
+        if (f->cls->kind != FUNC_TYPED)
+            continue;
+
+        printf("\nTyped function %d [%s] (%d total)\nStep 1: Validating and generating memory traces\n",
+               job->number, f->cls->name, num_kind_jobs[FUNC_TYPED]);
+        if (job->status < 0) {
+            printf("%sSkipping performance evaluation for this function.\n", job->error);
+            continue;
+        }
+        /* The baseline scans row by row; the others are blocked */
+        tileForElem(f->cls->elem, targets[0].s, targets[0].E, targets[0].b, &th, &tw);
+        if (f->baseline)
+            snprintf(label, sizeof(label), "%s", f->description);
+        else
+            snprintf(label, sizeof(label), "%s, %dx%d tiles", f->description, th, tw);
+        for (t = 0; t < num_targets; t++) {
+            printf("Step 2: Evaluating performance (s=%d, E=%d, b=%d)\n",
+                   targets[t].s, targets[t].E, targets[t].b);
+            printf("func %d [%s] (%s): hits:%u, misses:%u, evictions:%u\n",
+                   job->number, f->cls->name, label,
+                   job->hits[t], job->misses[t], job->evictions[t]);
+        }
+    }
+    if (use_fused)
+        report_fused();
+
+    /* Report the kernels of other families, which are not graded either */
+    for (i = 0; i < num_jobs; i++) {
+        job = &jobs[i];
+        f = &func_list[job->index];
+        if (f->cls->kind != FUNC_KERNEL)
+            continue;
+
+        printf("\nKernel %d [%s] (%d total)\nStep 1: Validating and generating memory traces\n",
+               job->number, f->cls->name, num_kind_jobs[FUNC_KERNEL]);
+        if (job->status < 0) {
+            if (use_valgrind)
+                printf("Validation error at kernel %d! %s", job->number, job->error);
+            else
+                printf("%s", job->error);
+            printf("Skipping performance evaluation for this function.\n");
+            continue;
+        }
+        for (t = 0; t < num_targets; t++) {
+            printf("Step 2: Evaluating performance (s=%d, E=%d, b=%d)\n",
+                   targets[t].s, targets[t].E, targets[t].b);
+            printf("func %d [%s] (%s): hits:%u, misses:%u, evictions:%u\n",
+                   job->number, f->cls->name, f->description,
+                   job->hits[t], job->misses[t], job->evictions[t]);
+        }
+    }
+    free(jobs);
 }
 
 /*
  * usage - Print usage info
  */
 void usage(char *argv[]){
-    printf("Usage: %s [-h] -M <rows> -N <cols>\n", argv[0]);
+    printf("Usage: %s [-hV] -M <rows> -N <cols> [-s <s> -E <E> -b <b>] [-c <s,E,b>]...\n", argv[0]);
+    printf("       [-j <threads>] [-t <type>]... [-f] [-k <family>]...\n");
     printf("Options:\n");
     printf("  -h          Print this help message.\n");
+    printf("  -V          Trace with valgrind instead of in-process; this also\n");
+    printf("              counts each function's stack frame, so the counts\n");
+    printf("              are not comparable with in-process ones\n");
     printf("  -M <rows>   Number of matrix rows (max %d)\n", MAXN);
     printf("  -N <cols>   Number of  matrix columns (max %d)\n", MAXN);
+    printf("  -s <s>      Set index bits of the graded cache (default 5)\n");
+    printf("  -E <E>      Lines per set of the graded cache (default 1)\n");
+    printf("  -b <b>      Block offset bits of the graded cache (default 5)\n");
+    printf("  -c <s,E,b>  Also evaluate on this cache (up to %d in total)\n", MAX_TARGETS);
+    printf("  -j <n>      Worker threads (default: one per CPU)\n");
+    printf("  -t <type>   Also evaluate the typed functions for int8, int16, int32,\n");
+    printf("              float, double or all\n");
+    printf("  -f          Also evaluate the fused functions against two-pass ones\n");
+    printf("  -k <family> Also evaluate the kernels for gemm, stencil, matvec or all\n");
     printf("Example: %s -M 8 -N 8\n", argv[0]);       
+    printf("Example: %s -M 64 -N 64 -s 6 -E 8 -b 6\n", argv[0]);
 }
 
 /*
@@ -198,8 +597,9 @@ void sigalrm_handler(int signum){
 int main(int argc, char* argv[])
 {
     char c;
+    int i;
 
-    while ((c = getopt(argc,argv,"M:N:h")) != -1) {
+    while ((c = getopt(argc,argv,"M:N:s:E:b:c:j:t:fk:hV")) != -1) {
         switch(c) {
         case 'M':
             M = atoi(optarg);
@@ -207,6 +607,61 @@ int main(int argc, char* argv[])
         case 'N':
             N = atoi(optarg);
             break;
+        case 'V':
+            use_valgrind = 1;
+            break;
+        case 's':
+            targets[0].s = atoi(optarg);
+            break;
+        case 'E':
+            targets[0].E = atoi(optarg);
+            break;
+        case 'b':
+            targets[0].b = atoi(optarg);
+            break;
+        case 'c':
+            if (num_targets == MAX_TARGETS ||
+                sscanf(optarg, "%u,%u,%u", &targets[num_targets].s,
+                       &targets[num_targets].E, &targets[num_targets].b) != 3) {
+                printf("Error: bad or too many cache targets: %s\n", optarg);
+                usage(argv);
+                exit(1);
+            }
+            num_targets++;
+            break;
+        case 't':
+            if (strcmp(optarg, "all") == 0) {
+                for (i = 0; i < NUM_ELEM_TYPES; i++)
+                    typed_selected[i] = 1;
+            } else if ((i = parseElem(optarg)) >= 0) {
+                typed_selected[i] = 1;
+            } else {
+                printf("Error: unknown element type %s\n", optarg);
+                usage(argv);
+                exit(1);
+            }
+            break;
+        case 'f':
+            use_fused = 1;
+            break;
+        case 'k':
+            for (i = 0; i < num_kernel_classes; i++)
+                if (strcmp(optarg, "all") == 0 || kernel_classes[i] == findKernelClass(optarg))
+                    kernel_selected[i] = 1;
+            if (strcmp(optarg, "all") != 0 && findKernelClass(optarg) == NULL) {
+                printf("Error: unknown kernel family %s\n", optarg);
+                usage(argv);
+                exit(1);
+            }
+            break;
+        case 'j':
+            num_workers = atoi(optarg);
+            if (num_workers <= 0) {
+                printf("Error: bad thread count: %s\n", optarg);
+                usage(argv);
+                exit(1);
+            }
+            break;
         case 'h':
             usage(argv);
             exit(0);
@@ -222,6 +677,26 @@ int main(int argc, char* argv[])
         exit(1);
     }
 
+    /* A block must hold at least one int */
+    if (targets[0].s > 30 || targets[0].E == 0 || targets[0].b < 2 || targets[0].b > 30) {
+        printf("Error: unsupported cache geometry s=%u, E=%u, b=%u\n",
+               targets[0].s, targets[0].E, targets[0].b);
+        usage(argv);
+        exit(1);
+    }
+    setTransCache(targets[0].s, targets[0].E, targets[0].b);
+
+    for (i = 0; i < NUM_ELEM_TYPES; i++) {
+        if (typed_selected[i] && use_valgrind) {
+            printf("Error: typed functions are only traced in-process, not with -V\n");
+            exit(1);
+        }
+    }
+    if (use_fused && use_valgrind) {
+        printf("Error: fused functions are only traced in-process, not with -V\n");
+        exit(1);
+    }
+
     if (M > MAXN || N > MAXN) {
         printf("Error: M or N exceeds %d\n", MAXN);
         usage(argv);
@@ -243,7 +718,7 @@ int main(int argc, char* argv[])
     alarm(120);
 
     /* Check the performance of the student's transpose function */
-    eval_perf(5, 1, 5);
+    eval_perf();
   
     /* Emit the results for this particular test */
     if (results.funcid == -1) {
@@ -255,6 +730,8 @@ int main(int argc, char* argv[])
     else {
         printf("\nSummary for official submission (func %d): correctness=%d misses=%d\n",
                results.funcid, results.correct, results.misses);
+        if (use_valgrind)
+            printf("Traced with valgrind: misses include the stack frame\n");
         printf("\nTEST_TRANS_RESULTS=%d:%d\n", results.correct, results.misses);
     }
     return 0;
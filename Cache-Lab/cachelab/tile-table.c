@@ -0,0 +1,18 @@
+/*
+ * tile-table.c - Tiling parameters chosen by ./autotune. Do not edit;
+ *     regenerate with:
+ *
+ *     ./autotune -o tile-table.c 32x32 64x64 61x67 48x48 96x96 128x128
+ */
+#include "tile.h"
+
+const tile_entry_t tile_table[] = {
+    {32, 32, 5, 1, 5, {17, 8, TILE_COL_ORDER, 0, TILE_BUF_ROW}}, /* 284 misses */
+    {64, 64, 5, 1, 5, {8, 8, TILE_ROW_ORDER, 0, TILE_BUF_SPLIT}}, /* 1176 misses */
+    {61, 67, 5, 1, 5, {17, 4, TILE_ROW_ORDER, 0, TILE_BUF_ROW}}, /* 1708 misses */
+    {48, 48, 5, 1, 5, {48, 8, TILE_COL_ORDER, 0, TILE_BUF_ROW}}, /* 644 misses */
+    {96, 96, 5, 1, 5, {16, 8, TILE_COL_ORDER, 0, TILE_BUF_ROW}}, /* 2556 misses */
+    {128, 128, 5, 1, 5, {4, 4, TILE_COL_ORDER, 0, TILE_BUF_SPLIT}}, /* 8640 misses */
+};
+
+const int tile_table_size = 6;
@@ -0,0 +1,140 @@
+/*
+ * tile.c - Parameterized tiled transpose kernels. This file is compiled
+ *     twice: normally, and with TRACE_BUILD and TRACE_CFLAGS for the
+ *     in-process tracer. Only the kernels go into the traced copy.
+ */
+#include <stddef.h>
+#include "cachelab.h"
+#include "tile.h"
+#include "schedule.h"
+
+/*
+ * copy_plain - Transpose rows [i0,i1) x columns [j0,j1) of A one
+ *     element at a time. With diag set, B[i][i] is written after the
+ *     rest of row i, so that in a tile on the diagonal the row of A is
+ *     not evicted by the store to the row of B that maps to the same set.
+ */
+static void copy_plain(int diag, int M, int N, int A[N][M], int B[M][N],
+                       int i0, int i1, int j0, int j1)
+{
+    int i, j, tmp, held;
+
+    for (i = i0; i < i1; i++) {
+        held = 0;
+        tmp = 0;
+        for (j = j0; j < j1; j++) {
+            if (diag && i == j) {
+                tmp = A[i][j];
+                held = 1;
+            } else {
+                B[j][i] = A[i][j];
+            }
+        }
+        if (held)
+            B[i][i] = tmp;
+    }
+}
+
+/*
+ * tile_rows_w8 - Like copy_plain, but each tile row of at most
+ *     TILE_MAX_BUF elements is loaded completely before any of it is
+ *     stored. The row is held in named temporaries rather than an
+ *     array, as the lab asks of trans.c, which calls this through
+ *     transpose_submit.
+ */
+SCHED_ROWS(tile, 8)
+
+#define TILE_COPY(v, r, c) (v)
+
+/*
+ * tile_square - Transpose a full tw x tw tile at (i, j) in quadrants,
+ *     on the schedule of trans_2 (see schedule.h)
+ */
+SCHED_SQUARE_TILES(tile, int, TILE_COPY)
+
+/*
+ * copy_tile - Transpose the tile at (i0, j0), clipped to the matrix
+ */
+static void copy_tile(const tile_params_t *p, int M, int N, int A[N][M], int B[M][N],
+                      int i0, int j0)
+{
+    int i1 = i0 + p->th < N ? i0 + p->th : N;
+    int j1 = j0 + p->tw < M ? j0 + p->tw : M;
+
+    if (p->buffered == TILE_BUF_SPLIT && i1 - i0 == p->th && j1 - j0 == p->tw)
+        tile_square(p->tw, M, N, A, B, NULL, i0, j0);
+    else if (p->buffered == TILE_BUF_ROW)
+        tile_rows_w8(M, N, A, B, i0, i1, j0, j1);
+    else
+        copy_plain(p->diag, M, N, A, B, i0, i1, j0, j1);
+}
+
+/*
+ * tileTranspose - Visit every tile in the requested order
+ */
+void tileTranspose(const tile_params_t *p, int M, int N, int A[N][M], int B[M][N])
+{
+    int i, j;
+
+    if (p->order == TILE_ROW_ORDER) {
+        for (i = 0; i < N; i += p->th)
+            for (j = 0; j < M; j += p->tw)
+                copy_tile(p, M, N, A, B, i, j);
+    } else {
+        for (j = 0; j < M; j += p->tw)
+            for (i = 0; i < N; i += p->th)
+                copy_tile(p, M, N, A, B, i, j);
+    }
+}
+
+#ifndef TRACE_BUILD
+
+/*
+ * tileForCache - Size a tile from the target cache
+ */
+void tileForCache(int *th, int *tw)
+{
+    tileForTarget(ELEM_INT32, th, tw);
+    if (*th > TILE_MAX_WIDTH)
+        *th = TILE_MAX_WIDTH;
+    if (*tw > TILE_MAX_WIDTH)
+        *tw = TILE_MAX_WIDTH;
+}
+
+/*
+ * tileValid - Check the parameters against what the kernels support
+ */
+int tileValid(const tile_params_t *p, int M, int N)
+{
+    if (p->th <= 0 || p->tw <= 0 || p->th > N || p->tw > M)
+        return 0;
+    if (p->order != TILE_ROW_ORDER && p->order != TILE_COL_ORDER)
+        return 0;
+    switch (p->buffered) {
+    case TILE_BUF_NONE:
+        return 1;
+    case TILE_BUF_ROW:
+        return p->tw <= TILE_MAX_BUF;
+    case TILE_BUF_SPLIT:
+        return p->th == p->tw && p->th % 2 == 0 && p->th <= TILE_MAX_BUF;
+    default:
+        return 0;
+    }
+}
+
+/*
+ * tileLookup - Find the tuned entry for a shape and cache
+ */
+const tile_params_t *tileLookup(int M, int N, int s, int E, int b)
+{
+    int i;
+
+    for (i = 0; i < tile_table_size; i++) {
+        const tile_entry_t *e = &tile_table[i];
+        if (e->M == M && e->N == N && e->s == s && e->E == E && e->b == b)
+            return &e->params;
+    }
+    return NULL;
+}
+
+#endif /* TRACE_BUILD */
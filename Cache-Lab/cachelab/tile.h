@@ -0,0 +1,74 @@
+/*
+ * tile.h - A parameterized family of tiled transpose kernels and the
+ *     dispatch table that picks one per matrix shape
+ *
+ * Every kernel in the family walks B = A^T in th x tw tiles of A. The
+ * parameters choose the tile size, the order the tiles are visited in,
+ * whether diagonal elements are deferred and how a tile's elements are
+ * buffered between the load from A and the store to B. ./autotune
+ * searches this space for a shape and cache and writes the winners to
+ * tile-table.c, which tileLookup consults at run time.
+ */
+
+#ifndef TILE_H
+#define TILE_H
+
+/* Tile visiting orders */
+#define TILE_ROW_ORDER 0    /* across a block row of A, then down */
+#define TILE_COL_ORDER 1    /* down a block column of A, then across */
+
+/* Buffering schemes */
+#define TILE_BUF_NONE  0    /* copy one element at a time */
+#define TILE_BUF_ROW   1    /* load a tile row into locals, then store it */
+#define TILE_BUF_SPLIT 2    /* square tiles in quadrants, staging the
+                               top-right quadrant in B (as in trans_2) */
+
+/* Widest tile row TILE_BUF_ROW can hold, in as many temporaries */
+#define TILE_MAX_BUF 8
+
+/* Widest tile tileForCache returns */
+#define TILE_MAX_WIDTH 32
+
+typedef struct tile_params{
+  int th, tw;         /* tile height (rows of A) and width */
+  int order;          /* TILE_ROW_ORDER or TILE_COL_ORDER */
+  int diag;           /* defer B[i][i] to the end of its row */
+  int buffered;       /* TILE_BUF_* */
+} tile_params_t;
+
+/* One row of the dispatch table */
+typedef struct tile_entry{
+  int M, N;           /* matrix shape */
+  int s, E, b;        /* cache the parameters were tuned for */
+  tile_params_t params;
+} tile_entry_t;
+
+/* Generated by ./autotune, see tile-table.c */
+extern const tile_entry_t tile_table[];
+extern const int tile_table_size;
+
+/* Return 1 if p describes a kernel tileTranspose can run, else 0 */
+int tileValid(const tile_params_t *p, int M, int N);
+
+/* Return the tuned parameters for a shape and cache, or NULL */
+const tile_params_t *tileLookup(int M, int N, int s, int E, int b);
+
+/* The int tile for the target cache (see setTransCache): th rows of A
+   by tw columns as tileForElem sizes them, capped at TILE_MAX_WIDTH.
+   The hand-written kernels of trans.c, fused.c and kernels.c use it. */
+void tileForCache(int *th, int *tw);
+
+/* B = A^T using the kernel described by p */
+void tileTranspose(const tile_params_t *p, int M, int N, int A[N][M], int B[M][N]);
+
+/*
+ * The instrumented build of the kernels (see memtrace.h) is compiled
+ * with TRACE_BUILD and gets its own name, so that both copies can be
+ * linked into one program.
+ */
+void tileTransposeTraced(const tile_params_t *p, int M, int N, int A[N][M], int B[M][N]);
+#ifdef TRACE_BUILD
+#define tileTranspose tileTransposeTraced
+#endif
+
+#endif /* TILE_H */
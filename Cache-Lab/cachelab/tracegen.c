@@ -3,8 +3,23 @@
  * a memory trace of all of the registered transpose functions. 
  * 
  * The beginning and end of each registered transpose function's trace
- * is indicated by reading from "marker" addresses. These two marker
- * addresses are recorded in file for later use.
+ * is indicated by writing to "marker" addresses. These two marker
+ * addresses are printed on stdout ("MARKERS <start> <end>") before any
+ * function runs, so a reader of the combined valgrind output learns
+ * them ahead of the traced region.
+ *
+ * Just before that, tracegen prints the address ranges the traced
+ * function may legitimately touch ("RANGE <name> <base> <len>"): the
+ * arrays its class describes (A and B for a transpose) and, when a
+ * single function is selected with -F or -K, its stack frame. The
+ * frame is measured with an untraced dry run that paints the stack
+ * below the call site and looks for the lowest byte the function
+ * overwrote. With -R the ranges are also written to .ranges, the
+ * format read by csim -r.
+ *
+ * -F k selects the k-th transpose function and -K k the k-th kernel of
+ * kernels.c. Each is run through the function list, and its result is
+ * checked by its class.
  */
 
 #include <stdlib.h>
@@ -22,36 +37,103 @@ extern int func_counter;
 /* External function from trans.c */
 extern void registerFunctions();
 
+/* External function for the kernels of kernels.c */
+extern void registerKernelFunctions(void);
+
 /* Markers used to bound trace regions of interest */
 volatile char MARKER_START, MARKER_END;
 
-static int A[256][256];
-static int B[256][256];
+/* Stack painting used to measure a function's frame */
+#define STACK_PROBE 65536
+#define STACK_PAINT 0xa5
+static unsigned char *paint_lo, *paint_hi;
+
+/* Address ranges the traced function may touch */
+static range_t ranges[MAX_FUNC_ARRAYS + 1];
+static int num_ranges = 0;
+
+/* The arrays of the function run, each with room for a 256 x 256 matrix */
+static int mem[MAX_FUNC_ARRAYS][256 * 256];
+static void *arrays[MAX_FUNC_ARRAYS];
 static int M;
 static int N;
 
+/*
+ * paint_stack - Fill STACK_PROBE bytes below the caller's frame with a
+ *     known pattern and remember where they are. The frame of a function
+ *     called next from the same caller lands in this area.
+ */
+static void __attribute__((noinline)) paint_stack(void) {
+    volatile unsigned char pad[STACK_PROBE];
+    memset((unsigned char *)pad, STACK_PAINT, sizeof(pad));
+    paint_lo = (unsigned char *)pad;
+    /* include the saved frame pointer and return address */
+    paint_hi = (unsigned char *)__builtin_frame_address(0) + 2 * sizeof(void *);
+}
 
-int validate(int fn,int M, int N, int A[N][M], int B[M][N]) {
-    int C[M][N];
-    memset(C,0,sizeof(C));
-    correctTrans(M,N,A,C);
-    for(int i=0;i<M;i++) {
-        for(int j=0;j<N;j++) {
-            if(B[i][j]!=C[i][j]) {
-                printf("Validation failed on function %d! Expected %d but got %d at B[%d][%d]\n",fn,C[i][j],B[i][j],i,j);
-                return 0;
-            }
-        }
+/*
+ * run_function - Fill the arrays of registered function fn and call it,
+ *     bracketed by the markers if traced. If frame is non-NULL, measure
+ *     the stack used by fn.
+ */
+static void __attribute__((noinline)) run_function(int fn, int traced, range_t *frame) {
+    unsigned char *p;
+
+    func_list[fn].cls->init(M, N, arrays);
+    if (frame)
+        paint_stack();
+    if (traced)
+        MARKER_START = 33;
+    if (func_list[fn].cls->kind == FUNC_TRANS)
+        (*func_list[fn].func_ptr)(M, N, arrays[0], arrays[1]);
+    else
+        (*func_list[fn].array_func)(M, N, arrays);
+    if (traced)
+        MARKER_END = 34;
+
+    if (frame) {
+        for (p = paint_lo; p < paint_hi && *p == STACK_PAINT; p++)
+            ;
+        p = (unsigned char *)((unsigned long long int)p & ~15ULL);
+        strcpy(frame->name, "stack");
+        frame->base = (unsigned long long int)p;
+        frame->len = paint_hi - p;
+    }
+}
+
+/*
+ * validate - Check the result of registered function fn, numbered num
+ *     among those of its kind, with its class. Returns 1 if it is right.
+ */
+static int validate(int fn, int num) {
+    const func_class_t *cls = func_list[fn].cls;
+    long bad = cls->check(M, N, arrays);
+
+    if (bad >= 0) {
+        printf("Validation failed on %s %d! Wrong value at %s[%ld]\n",
+               cls->kind == FUNC_KERNEL ? "kernel" : "function", num,
+               cls->array_names[cls->output], bad);
+        return 0;
     }
     return 1;
 }
 
+static void add_range(const char *name, void *base, unsigned long long int len) {
+    strcpy(ranges[num_ranges].name, name);
+    ranges[num_ranges].base = (unsigned long long int)base;
+    ranges[num_ranges].len = len;
+    num_ranges++;
+}
+
 int main(int argc, char* argv[]){
     int i;
+    const func_class_t *cls;
 
     char c;
-    int selectedFunc=-1;
-    while( (c=getopt(argc,argv,"M:N:F:")) != -1){
+    int selectedFunc=-1, selectedNum=-1, selectedKind=FUNC_TRANS;
+    int s=5, E=1, b=5;
+    int writeRanges=0;
+    while( (c=getopt(argc,argv,"M:N:F:K:s:E:b:R")) != -1){
         switch(c){
         case 'M':
             M = atoi(optarg);
@@ -60,7 +142,23 @@ int main(int argc, char* argv[]){
             N = atoi(optarg);
             break;
         case 'F':
-            selectedFunc = atoi(optarg);
+            selectedNum = atoi(optarg);
+            break;
+        case 'K':
+            selectedNum = atoi(optarg);
+            selectedKind = FUNC_KERNEL;
+            break;
+        case 's':
+            s = atoi(optarg);
+            break;
+        case 'E':
+            E = atoi(optarg);
+            break;
+        case 'b':
+            b = atoi(optarg);
+            break;
+        case 'R':
+            writeRanges = 1;
             break;
         case '?':
         default:
@@ -70,38 +168,65 @@ int main(int argc, char* argv[]){
     }
   
 
-    /*  Register transpose functions */
+    /*  Register the functions and tune them for the given cache */
     registerFunctions();
+    registerKernelFunctions();
+    setTransCache(s, E, b);
+
+    /* Announce the arrays of the selected function, or A and B when every
+       transpose function is run */
+    if (-1!=selectedNum) {
+        selectedFunc = findFunction(selectedKind, selectedNum);
+        if (selectedFunc < 0) {
+            printf("./tracegen: no %s %d\n",
+                   selectedKind == FUNC_KERNEL ? "kernel" : "function", selectedNum);
+            exit(1);
+        }
+    }
+    cls = func_list[-1!=selectedFunc ? selectedFunc : 0].cls;
+    for (i=0; i < cls->num_arrays; i++) {
+        arrays[i] = mem[i];
+        add_range(cls->array_names[i], arrays[i],
+                  elemSize(cls->elem) * cls->array_len(i, M, N));
+    }
+    if (-1!=selectedFunc) {
+        /* Warm up first, so that lazy symbol binding does not add to the frame */
+        run_function(selectedFunc, 0, NULL);
+        run_function(selectedFunc, 0, &ranges[num_ranges]);
+        num_ranges++;
+    }
 
-    /* Fill A with data */
-    initMatrix(M,N, A, B); 
-
-    /* Record marker addresses */
-    FILE* marker_fp = fopen(".marker","w");
-    assert(marker_fp);
-    fprintf(marker_fp, "%llx %llx", 
-            (unsigned long long int) &MARKER_START,
-            (unsigned long long int) &MARKER_END );
-    fclose(marker_fp);
+    /* Announce the ranges and marker addresses ahead of the traced region */
+    for (i=0; i < num_ranges; i++)
+        printf("RANGE %s %llx %llu\n", ranges[i].name, ranges[i].base, ranges[i].len);
+    printf("MARKERS %llx %llx\n",
+           (unsigned long long int) &MARKER_START,
+           (unsigned long long int) &MARKER_END);
+    fflush(stdout);
+
+    /* Record the ranges so csim -r can attribute misses */
+    if (writeRanges) {
+        FILE* range_fp = fopen(".ranges","w");
+        assert(range_fp);
+        for (i=0; i < num_ranges; i++)
+            fprintf(range_fp, "%s %llx %llu\n", ranges[i].name, ranges[i].base, ranges[i].len);
+        fclose(range_fp);
+    }
 
     if (-1==selectedFunc) {
         /* Invoke registered transpose functions */
         for (i=0; i < func_counter; i++) {
-            MARKER_START = 33;
-            (*func_list[i].func_ptr)(M, N, A, B);
-            MARKER_END = 34;
-            if (!validate(i,M,N,A,B))
+            if (func_list[i].cls->kind != FUNC_TRANS)
+                continue;
+            run_function(i, 1, NULL);
+            if (!validate(i, i))
                 return i+1;
         }
     } else {
-        MARKER_START = 33;
-        (*func_list[selectedFunc].func_ptr)(M, N, A, B);
-        MARKER_END = 34;
-        if (!validate(selectedFunc,M,N,A,B))
-            return selectedFunc+1;
+        run_function(selectedFunc, 1, NULL);
+        if (!validate(selectedFunc, selectedNum))
+            return selectedNum+1;
 
     }
     return 0;
 }
-
-
@@ -5,15 +5,23 @@
  * void trans(int M, int N, int A[N][M], int B[M][N]);
  *
  * A transpose function is evaluated by counting the number of misses
- * on a 1KB direct mapped cache with a block size of 32 bytes.
+ * on a 1KB direct mapped cache with a block size of 32 bytes, unless
+ * another cache is chosen with test-trans -s/-E/-b (see setTransCache).
  */ 
 #include <stdio.h>
 #include "cachelab.h"
+#include "tile.h"
+#include "simd.h"
+#include "schedule.h"
 
 int is_transpose(int M, int N, int A[N][M], int B[M][N]);
 void trans_1(int M, int N, int A[N][M], int B[M][N]);
 void trans_2(int M, int N, int A[N][M], int B[M][N]);
 void trans_3(int M, int N, int A[N][M], int B[M][N]);
+void trans_recursive(int M, int N, int A[N][M], int B[M][N]);
+void trans_simd(int M, int N, int A[N][M], int B[M][N]);
+void trans_inplace_tiles(int M, int N, int A[N][M], int B[M][N]);
+void trans_inplace_cycles(int M, int N, int A[N][M], int B[M][N]);
 
 /* 
  * transpose_submit - This is the solution transpose function that you
@@ -21,13 +29,25 @@ void trans_3(int M, int N, int A[N][M], int B[M][N]);
  *     the description string "Transpose submission", as the driver
  *     searches for that string to identify the transpose function to
  *     be graded. 
+ *
+ *     Shapes tuned by ./autotune (see tile-table.c) for the target
+ *     cache use the kernel it chose; the rest fall back to the
+ *     hand-written kernels, which size their tiles from the cache, or
+ *     to the cache-oblivious recursive transpose.
  */
 char transpose_submit_desc[] = "Transpose submission";
 void transpose_submit(int M, int N, int A[N][M], int B[M][N])
 {
-    if (M == 32 && N == 32) trans_1(M, N, A, B);
+    const tile_params_t *tuned;
+    int s, E, b;
+
+    getTransCache(&s, &E, &b);
+    tuned = tileLookup(M, N, s, E, b);
+    if (tuned) tileTranspose(tuned, M, N, A, B);
+    else if (M == 32 && N == 32) trans_1(M, N, A, B);
     else if ((M == 64 && N == 64)) trans_2(M, N, A, B);
     else if ((M == 61 && N == 67)) trans_3(M, N, A, B);
+    else trans_recursive(M, N, A, B);
 }
 
 /* 
@@ -35,137 +55,234 @@ void transpose_submit(int M, int N, int A[N][M], int B[M][N])
  * a simple one below to help you get started. 
  */ 
 /* 
- * trans_1: transpose optimized function for 32 x 32 Matrix
+ * The kernels below size their tiles from the target cache (see
+ * setTransCache) rather than assuming 32-byte blocks: a tile is one
+ * block of ints wide, 8 on the graded cache and 16 with 64-byte lines.
+ * A tile row is held in named temporaries t0, t1, ... between the load
+ * from A and the stores to B, as the lab's rules ask (no arrays, at
+ * most 12 int locals on the graded cache). Each kernel is therefore
+ * written once as a macro and expanded for every width from 1 to
+ * TILE_MAX_WIDTH; trans_1 and trans_2 use the schedules of schedule.h,
+ * which fused.c and tile.c share.
+ */
+
+#define TRANS_COPY(v, r, c) (v)
+
+SCHED_KERNELS(trans, int, TRANS_COPY)
+
+/* 
+ * trans_3_w<W> - Strips of A W wide walked from top to bottom, then the
+ *     columns past the last whole strip one element at a time
+ */
+#define T3_LOAD(n, a)  t##n = A[i][j + n];
+#define T3_STORE(n, a) B[j + n][i] = t##n;
+
+#define TRANS_3_KERNEL(W) \
+static void trans_3_w##W(int M, int N, int A[N][M], int B[M][N]) \
+{ \
+    int i, j; \
+    SCHED_EACH_##W(SCHED_DECL, 0) \
+    int col_limit = M - (M % (W)); \
+    for (j = 0; j < col_limit; j += W) { \
+        for (i = 0; i < N; i++) { \
+            SCHED_EACH_##W(T3_LOAD, 0) \
+            SCHED_EACH_##W(T3_STORE, 0) \
+        } \
+    } \
+    /* transpose rest elements */ \
+    for (i = 0; i < N; i++) { \
+        for (j = col_limit; j < M; j++) { \
+            t0 = A[i][j]; \
+            B[j][i] = t0; \
+        } \
+    } \
+}
+
+TRANS_3_KERNEL(1)
+TRANS_3_KERNEL(2)
+TRANS_3_KERNEL(4)
+TRANS_3_KERNEL(8)
+TRANS_3_KERNEL(16)
+TRANS_3_KERNEL(32)
+
+/* 
+ * trans_1: transpose optimized function for 32 x 32 Matrix, in tiles
+ *     one block wide
  */
 void trans_1(int M, int N, int A[N][M], int B[M][N])
 {
-    int i, j, k;
-    int tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8;
-    for (j = 0; j < M; j += 8) {
-        for (i = 0; i < N; i += 8 ) {
-            for (k = i; k < i + 8; k++) {
-                tmp1 = A[k][j];
-                tmp2 = A[k][j + 1];
-                tmp3 = A[k][j + 2];
-                tmp4 = A[k][j + 3];
-                tmp5 = A[k][j + 4];
-                tmp6 = A[k][j + 5];
-                tmp7 = A[k][j + 6];
-                tmp8 = A[k][j + 7];
-
-                B[j][k] = tmp1;
-                B[j + 1][k] = tmp2;
-                B[j + 2][k] = tmp3;
-                B[j + 3][k] = tmp4;
-                B[j + 4][k] = tmp5;
-                B[j + 5][k] = tmp6;
-                B[j + 6][k] = tmp7;
-                B[j + 7][k] = tmp8;
-            }
-        }
-    }
+    int th, tw;
+
+    tileForCache(&th, &tw);
+    trans_strips(th, tw, M, N, A, B, NULL);
 }
 
 /* 
- * trans_2: transpose optimized function for 64 x 64 Matrix
+ * trans_2: transpose optimized function for 64 x 64 Matrix. Square
+ *     tiles of one block are split into quadrants of half a block, since
+ *     on the graded cache rows of B four apart map to the same set.
+ *     Shapes the tile does not divide use trans_1.
  */
 void trans_2(int M, int N, int A[N][M], int B[M][N])
 {
-    int i, j, k;
-    int tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8;
-    for (i = 0; i < N; i += 8) {
-        for (j = 0; j < M; j += 8) {
-            for (k = 0; k < 4; k++) {
-                tmp1 = A[i + k][j];
-                tmp2 = A[i + k][j + 1];
-                tmp3 = A[i + k][j + 2];
-                tmp4 = A[i + k][j + 3];
-                tmp5 = A[i + k][j + 4];
-                tmp6 = A[i + k][j + 5];
-                tmp7 = A[i + k][j + 6];
-                tmp8 = A[i + k][j + 7];
-
-                B[j][i + k] = tmp1;
-                B[j + 1][i + k] = tmp2;
-                B[j + 2][i + k] = tmp3;
-                B[j + 3][i + k] = tmp4;
-                B[j][i + k + 4] = tmp5;
-                B[j + 1][i + k + 4] = tmp6;
-                B[j + 2][i + k + 4] = tmp7;
-                B[j + 3][i + k + 4] = tmp8;
-            }
+    int th, tw;
 
-            for (k = 0; k < 4; k++) {
-                tmp1 = A[i + 4][j + k];
-                tmp2 = A[i + 5][j + k];
-                tmp3 = A[i + 6][j + k];
-                tmp4 = A[i + 7][j + k];
-                tmp5 = B[j + k][i + 4];
-                tmp6 = B[j + k][i + 5];
-                tmp7 = B[j + k][i + 6];
-                tmp8 = B[j + k][i + 7];
-
-                B[j + k][i + 4] = tmp1;
-                B[j + k][i + 5] = tmp2;
-                B[j + k][i + 6] = tmp3;
-                B[j + k][i + 7] = tmp4;
-                B[j + k + 4][i] = tmp5;
-                B[j + k + 4][i + 1] = tmp6;
-                B[j + k + 4][i + 2] = tmp7;
-                B[j + k + 4][i + 3] = tmp8;
+    tileForCache(&th, &tw);
+    trans_squares(th, tw, M, N, A, B, NULL);
+}
 
-            }
+/* 
+ * trans_3: transpose optimized function for 61 x 67 Matrix. Strips of
+ *     A one block wide are walked from top to bottom.
+ */
+void trans_3(int M, int N, int A[N][M], int B[M][N])
+{
+    int th, tw;
 
-            for (k = 4; k < 8; k++) {
-                tmp1 = A[i + k][j + 4];
-                tmp2 = A[i + k][j + 5];
-                tmp3 = A[i + k][j + 6];
-                tmp4 = A[i + k][j + 7];
+    tileForCache(&th, &tw);
+    switch (tw) {
+    case 1:  trans_3_w1(M, N, A, B); break;
+    case 2:  trans_3_w2(M, N, A, B); break;
+    case 4:  trans_3_w4(M, N, A, B); break;
+    case 8:  trans_3_w8(M, N, A, B); break;
+    case 16: trans_3_w16(M, N, A, B); break;
+    default: trans_3_w32(M, N, A, B); break;
+    }
+}
 
-                B[j + 4][i + k] = tmp1;
-                B[j + 5][i + k] = tmp2;
-                B[j + 6][i + k] = tmp3;
-                B[j + 7][i + k] = tmp4;
-            }
+/* 
+ * The base case of the recursive transpose, at most a th x tw tile as
+ * tileForCache sizes it: one row of A loaded into named temporaries at a
+ * time, so that a row fills a cache block. Powers of two
+ * such as 64x64, where rows of A and B collide in the cache, still need
+ * a kernel like trans_2.
+ */
+SCHED_ROWS(rec, 1)
+SCHED_ROWS(rec, 2)
+SCHED_ROWS(rec, 4)
+SCHED_ROWS(rec, 8)
+SCHED_ROWS(rec, 16)
+SCHED_ROWS(rec, 32)
+
+/* 
+ * trans_rec - Transpose rows [i0,i1) x columns [j0,j1) of A by halving
+ *     the longer side, split on a multiple of th rows or tw columns so
+ *     that leaves line up with tiles, until the piece is a base-case tile
+ */
+static void trans_rec(int th, int tw, int M, int N, int A[N][M], int B[M][N],
+                      int i0, int i1, int j0, int j1)
+{
+    int mid;
+
+    if (i1 - i0 <= th && j1 - j0 <= tw) {
+        switch (tw) {
+        case 1:  rec_rows_w1(M, N, A, B, i0, i1, j0, j1); break;
+        case 2:  rec_rows_w2(M, N, A, B, i0, i1, j0, j1); break;
+        case 4:  rec_rows_w4(M, N, A, B, i0, i1, j0, j1); break;
+        case 8:  rec_rows_w8(M, N, A, B, i0, i1, j0, j1); break;
+        case 16: rec_rows_w16(M, N, A, B, i0, i1, j0, j1); break;
+        default: rec_rows_w32(M, N, A, B, i0, i1, j0, j1); break;
         }
+    } else if (i1 - i0 > th && (i1 - i0 >= j1 - j0 || j1 - j0 <= tw)) {
+        mid = i0 + ((i1 - i0) / 2 + th - 1) / th * th;
+        trans_rec(th, tw, M, N, A, B, i0, mid, j0, j1);
+        trans_rec(th, tw, M, N, A, B, mid, i1, j0, j1);
+    } else {
+        mid = j0 + ((j1 - j0) / 2 + tw - 1) / tw * tw;
+        trans_rec(th, tw, M, N, A, B, i0, i1, j0, mid);
+        trans_rec(th, tw, M, N, A, B, i0, i1, mid, j1);
     }
 }
 
 /* 
- * trans_3: transpose optimized function for 61 x 67 Matrix
+ * trans_recursive - Cache-oblivious transpose for any M and N. The
+ *     recursion depth grows only with log(M + N), so it is not limited
+ *     to the sizes the test harness can allocate.
  */
-void trans_3(int M, int N, int A[N][M], int B[M][N])
+char trans_recursive_desc[] = "Cache-oblivious recursive transpose";
+void trans_recursive(int M, int N, int A[N][M], int B[M][N])
 {
-    int i, j;
-    int tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8;
-    int col_limit = M - (M % 8);
-    for (j = 0; j < col_limit; j += 8) {
-        for (i = 0; i < N; i++) {
-                tmp1 = A[i][j];
-                tmp2 = A[i][j + 1];
-                tmp3 = A[i][j + 2];
-                tmp4 = A[i][j + 3];
-                tmp5 = A[i][j + 4];
-                tmp6 = A[i][j + 5];
-                tmp7 = A[i][j + 6];
-                tmp8 = A[i][j + 7];
-
-                B[j][i] = tmp1;
-                B[j + 1][i] = tmp2;
-                B[j + 2][i] = tmp3;
-                B[j + 3][i] = tmp4;
-                B[j + 4][i] = tmp5;
-                B[j + 5][i] = tmp6;
-                B[j + 6][i] = tmp7;
-                B[j + 7][i] = tmp8;
-        }
+    int th, tw;
+
+    tileForCache(&th, &tw);
+    trans_rec(th, tw, M, N, A, B, 0, N, 0, M);
+}
+
+/* 
+ * trans_simd - Transposes 8x8 (AVX2) or 4x4 (SSE2) tiles in vector
+ *     registers, whichever the CPU supports, see simd.c
+ */
+char trans_simd_desc[] = "SIMD register-tile transpose";
+void trans_simd(int M, int N, int A[N][M], int B[M][N])
+{
+    simdTranspose(M, N, A, B);
+}
+
+/* 
+ * trans_inplace_cycles - In-place transpose of any shape. Element p of
+ *     A (counting row by row) belongs at p * N mod (MN - 1) of the
+ *     result; each cycle of that permutation is rotated once, from its
+ *     smallest position. A position leads its cycle if walking the cycle
+ *     from it reaches no smaller one, so no memory besides A is needed.
+ *     B is not used. The price is a walk from every position, a modulo
+ *     per step: on rectangular shapes it takes about 110 ns per element
+ *     here against under 2 for the tiled kernels, and the cost per
+ *     element does not shrink with the size. It suits only cases where
+ *     a second matrix does not fit.
+ */
+char trans_inplace_cycles_desc[] = "In-place cycle-following transpose";
+void trans_inplace_cycles(int M, int N, int A[N][M], int B[M][N])
+{
+    int *a = &A[0][0];
+    long last = (long)M * N - 1, k, p, next;
+    int tmp, displaced;
+
+    for (k = 1; k < last; k++) {
+        for (p = k * N % last; p > k; p = p * N % last)
+            ;
+        if (p < k)
+            continue;
+        p = k;
+        tmp = a[k];
+        do {
+            next = p * N % last;
+            displaced = a[next];
+            a[next] = tmp;
+            tmp = displaced;
+            p = next;
+        } while (p != k);
     }
+}
 
-    /* transpose rest elements */
-    for (i = 0; i < N; i++) {
-        for (j = col_limit; j < M; j++) {
-            tmp1 = A[i][j];
-            B[j][i] = tmp1;
+/* 
+ * trans_inplace_tiles - In-place transpose of a square matrix: each
+ *     square tile above the diagonal is swapped element by element with
+ *     its mirror below it, and tiles on the diagonal are transposed
+ *     within themselves. The side is the smaller of tileForCache's th
+ *     and tw, so that a tile row is a cache block and a tile and its
+ *     mirror fit together. Other shapes use trans_inplace_cycles.
+ */
+char trans_inplace_tiles_desc[] = "In-place tile-pair swap transpose";
+void trans_inplace_tiles(int M, int N, int A[N][M], int B[M][N])
+{
+    int th, tw, ii, jj, i, j, tmp;
+
+    if (M != N) {
+        trans_inplace_cycles(M, N, A, B);
+        return;
+    }
+    tileForCache(&th, &tw);
+    if (th < tw)
+        tw = th;
+    for (ii = 0; ii < N; ii += tw) {
+        for (jj = ii; jj < N; jj += tw) {
+            for (i = ii; i < ii + tw && i < N; i++) {
+                for (j = (ii == jj ? i + 1 : jj); j < jj + tw && j < N; j++) {
+                    tmp = A[i][j];
+                    A[i][j] = A[j][i];
+                    A[j][i] = tmp;
+                }
+            }
         }
     }
 }
@@ -202,6 +319,14 @@ void registerFunctions()
     /* Register any additional transpose functions */
     registerTransFunction(trans, trans_desc); 
 
+    registerTransFunction(trans_recursive, trans_recursive_desc); 
+
+    registerTransFunction(trans_simd, trans_simd_desc); 
+
+    /* In-place functions leave the result in A instead of B */
+    registerInPlaceTransFunction(trans_inplace_tiles, trans_inplace_tiles_desc); 
+    registerInPlaceTransFunction(trans_inplace_cycles, trans_inplace_cycles_desc); 
+
 }
 
 /* 
@@ -0,0 +1,134 @@
+/*
+ * transbench.c - Measures the wall-clock speed of the registered
+ *     transpose functions, which simulated misses alone do not capture
+ *     (instruction count, vector width, branch overhead).
+ *
+ * trans.c is linked here in an optimized, uninstrumented build. Each
+ * function is checked once and then timed as the best of several runs
+ * of at least MIN_NS each, reported in nanoseconds per element. The
+ * matrices are allocated on the heap, so M and N are not limited to the
+ * MAXN of test-trans. In-place functions are timed on alternating
+ * M x N and N x M calls, each undoing the previous one.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <getopt.h>
+#include "cachelab.h"
+#include "simd.h"
+
+#define TIME_RUNS 5
+#define MIN_NS 20000000
+
+/* External function defined in trans.c */
+extern void registerFunctions();
+
+/* External variables defined in cachelab.c */
+extern trans_func_t func_list[MAX_TRANS_FUNCS];
+extern int func_counter;
+
+static double elapsed_ns(struct timespec *start, struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+/*
+ * time_function - Best ns per element of function i over TIME_RUNS runs
+ */
+static double time_function(int i, int M, int N, void *A, void *B)
+{
+    struct timespec start, end;
+    double ns, best = 0;
+    long reps;
+    int run;
+
+    for (run = 0; run < TIME_RUNS; run++) {
+        reps = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        do {
+            if (func_list[i].cls == &in_place_class && reps % 2 == 1)
+                (*func_list[i].func_ptr)(N, M, A, B);
+            else
+                (*func_list[i].func_ptr)(M, N, A, B);
+            reps++;
+            clock_gettime(CLOCK_MONOTONIC, &end);
+        } while (elapsed_ns(&start, &end) < MIN_NS);
+        ns = elapsed_ns(&start, &end) / reps / ((double)M * N);
+        if (run == 0 || ns < best)
+            best = ns;
+    }
+    return best;
+}
+
+static void usage(char *argv[])
+{
+    printf("Usage: %s [-h] -M <rows> -N <cols> [-i <isa>]\n", argv[0]);
+    printf("Options:\n");
+    printf("  -M <rows>   Number of matrix rows\n");
+    printf("  -N <cols>   Number of matrix columns\n");
+    printf("  -i <isa>    Use at most this instruction set: scalar, sse2 or avx2\n");
+    printf("Example: %s -M 1024 -N 1024 -i sse2\n", argv[0]);
+}
+
+int main(int argc, char *argv[])
+{
+    int M = 0, N = 0, level, i;
+    void *a, *b;
+    char c;
+
+    while ((c = getopt(argc, argv, "M:N:i:h")) != -1) {
+        switch (c) {
+        case 'M':
+            M = atoi(optarg);
+            break;
+        case 'N':
+            N = atoi(optarg);
+            break;
+        case 'i':
+            if ((level = simdParseLevel(optarg)) < 0) {
+                printf("Error: unknown instruction set %s\n", optarg);
+                usage(argv);
+                exit(1);
+            }
+            simdLimitLevel(level);
+            break;
+        case 'h':
+            usage(argv);
+            exit(0);
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+    if (M <= 0 || N <= 0) {
+        printf("Error: Missing required argument\n");
+        usage(argv);
+        exit(1);
+    }
+
+    if (posix_memalign(&a, 64, sizeof(int) * M * N) != 0 ||
+        posix_memalign(&b, 64, sizeof(int) * M * N) != 0) {
+        printf("Error: out of memory\n");
+        exit(1);
+    }
+    void *arrays[] = {a, b};
+
+    registerFunctions();
+    printf("M=%d N=%d, SIMD level %s\n", M, N, simdLevelName(simdLevel()));
+
+    for (i = 0; i < func_counter; i++) {
+        func_list[i].cls->init(M, N, arrays);
+        (*func_list[i].func_ptr)(M, N, a, b);
+        if (func_list[i].cls->check(M, N, arrays) >= 0) {
+            printf("func %d (%s): incorrect, not timed\n", i, func_list[i].description);
+            continue;
+        }
+        printf("func %d (%s): %.3f ns/elem\n", i, func_list[i].description,
+               time_function(i, M, N, a, b));
+    }
+
+    free(a);
+    free(b);
+    return 0;
+}
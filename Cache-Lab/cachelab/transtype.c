@@ -0,0 +1,86 @@
+/*
+ * transtype.c - Type-generic transpose functions for int8, int16, int32,
+ *     float and double matrices
+ *
+ * Each kernel is written once as a macro and instantiated per element
+ * type, and registered with that type's class (see typed_classes). The
+ * tile comes from the element width and the target cache, see
+ * tileForTarget: one block of elements wide, so a 32-byte block gives
+ * 8x8 tiles of ints but 4x4 of doubles and 32-wide tiles of int8.
+ * test-trans evaluates them (-t) from a build with TRACE_CFLAGS.
+ */
+#include <stdint.h>
+#include "cachelab.h"
+
+/* Widest tile row the blocked kernel can buffer: a 32-byte block of int8 */
+#define TYPED_MAX_TW 32
+
+/*
+ * naive_<type> - Row-wise scan, the typed twin of trans()
+ */
+#define TYPED_NAIVE(name, type) \
+static void naive_##name(int M, int N, void *arrays[]) \
+{ \
+    const type (*A)[M] = arrays[0]; \
+    type (*B)[N] = arrays[1]; \
+    int i, j; \
+    for (i = 0; i < N; i++) \
+        for (j = 0; j < M; j++) \
+            B[j][i] = A[i][j]; \
+}
+
+/*
+ * blocked_<type> - th x tw tiles, each tile row of A loaded into locals
+ *     before it is stored down a column of B
+ */
+#define TYPED_BLOCKED(name, type, elem) \
+static void blocked_##name(int M, int N, void *arrays[]) \
+{ \
+    const type (*A)[M] = arrays[0]; \
+    type (*B)[N] = arrays[1]; \
+    type buf[TYPED_MAX_TW]; \
+    int ii, jj, i, j, i1, j1, th, tw; \
+    tileForTarget(elem, &th, &tw); \
+    if (tw > TYPED_MAX_TW) \
+        tw = TYPED_MAX_TW; \
+    for (jj = 0; jj < M; jj += tw) { \
+        j1 = jj + tw < M ? jj + tw : M; \
+        for (ii = 0; ii < N; ii += th) { \
+            i1 = ii + th < N ? ii + th : N; \
+            for (i = ii; i < i1; i++) { \
+                for (j = jj; j < j1; j++) \
+                    buf[j - jj] = A[i][j]; \
+                for (j = jj; j < j1; j++) \
+                    B[j][i] = buf[j - jj]; \
+            } \
+        } \
+    } \
+}
+
+#define TYPED_KERNELS(name, type, elem) \
+    TYPED_NAIVE(name, type) \
+    TYPED_BLOCKED(name, type, elem)
+
+TYPED_KERNELS(int8, int8_t, ELEM_INT8)
+TYPED_KERNELS(int16, int16_t, ELEM_INT16)
+TYPED_KERNELS(int32, int32_t, ELEM_INT32)
+TYPED_KERNELS(float, float, ELEM_FLOAT)
+TYPED_KERNELS(double, double, ELEM_DOUBLE)
+
+/*
+ * registerTypedFunctions - Register both kernels for every element type.
+ *     The row-wise scan, which uses no tiles, is the baseline.
+ */
+void registerTypedFunctions(void)
+{
+    registerClassFunction(&typed_classes[ELEM_INT8], blocked_int8, "Blocked transpose", 0);
+    registerClassFunction(&typed_classes[ELEM_INT8], naive_int8, "Simple row-wise scan transpose", 1);
+    registerClassFunction(&typed_classes[ELEM_INT16], blocked_int16, "Blocked transpose", 0);
+    registerClassFunction(&typed_classes[ELEM_INT16], naive_int16, "Simple row-wise scan transpose", 1);
+    registerClassFunction(&typed_classes[ELEM_INT32], blocked_int32, "Blocked transpose", 0);
+    registerClassFunction(&typed_classes[ELEM_INT32], naive_int32, "Simple row-wise scan transpose", 1);
+    registerClassFunction(&typed_classes[ELEM_FLOAT], blocked_float, "Blocked transpose", 0);
+    registerClassFunction(&typed_classes[ELEM_FLOAT], naive_float, "Simple row-wise scan transpose", 1);
+    registerClassFunction(&typed_classes[ELEM_DOUBLE], blocked_double, "Blocked transpose", 0);
+    registerClassFunction(&typed_classes[ELEM_DOUBLE], naive_double, "Simple row-wise scan transpose", 1);
+}
@@ -0,0 +1,419 @@
+/*
+ * transweep.c - Evaluates every registered transpose function over a
+ *     grid of matrix shapes on one target cache, to show how each one
+ *     degrades with the shape and to catch regressions.
+ *
+ * Every function is run on every M x N of the grid through the
+ * instrumented build of trans.c and its accesses to A and B are
+ * simulated in-process, as test-trans does; the (function, shape) pairs
+ * are shared out among a pool of worker threads. The result is a
+ * matrix of misses per element for each function, printed in full for
+ * small grids and summarized otherwise.
+ *
+ * With -o the raw miss counts are written out, one "M N misses
+ * description" line per function and shape under a header naming the
+ * cache and the SIMD level, since the vector kernels touch memory in a
+ * different order at each level. With -r such a file is read back as
+ * the baseline: any count that grew by more than -T percent, and any
+ * function that no longer transposes correctly, is reported as a
+ * regression and the exit status is 1. The sweep runs at the
+ * baseline's SIMD level, and fails if this CPU does not have it.
+ *
+ * Usage: ./transweep [-s <s>] [-E <E>] [-b <b>] [-m <min>] [-x <max>]
+ *            [-k <step>] [-j <threads>] [-i <isa>] [-o <file>] [-r <file>]
+ *            [-T <pct>]
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include "cachelab.h"
+#include "cachesim.h"
+#include "memtrace.h"
+#include "simd.h"
+
+/* Maximum array dimension, as in test-trans */
+#define MAXN 256
+
+/* Grids with at most this many sizes per side are printed in full */
+#define MAX_PRINTED 16
+
+/* External function defined in trans.c */
+extern void registerFunctions();
+
+/* External variables defined in cachelab.c */
+extern trans_func_t func_list[MAX_TRANS_FUNCS];
+extern int func_counter;
+
+/* One function on one shape */
+typedef struct {
+    int fn, M, N;
+    int misses;         /* -1 if the function got it wrong */
+} sweep_job_t;
+
+/* Target cache */
+static int s = 5, E = 1, b = 5;
+
+/* Sizes used for both M and N */
+static int sizes[MAXN];
+static int num_sizes = 0;
+
+static sweep_job_t *jobs;
+static int num_jobs = 0, next_job = 0;
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * simulate - Trace one run of a function on the worker's matrices and
+ *     return its misses, or -1 if its class finds the result wrong. A
+ *     vector access that straddles blocks touches each of them.
+ */
+static int simulate(int fn, int M, int N, int (*matrices)[MAXN][MAXN])
+{
+    const func_class_t *cls = func_list[fn].cls;
+    void *arrays[] = {matrices[0], matrices[1]};
+    unsigned long long int base = (unsigned long long int)matrices, blk, last;
+    mem_access_t *trace;
+    cache_t cache;
+    int k, count, misses;
+
+    cls->init(M, N, arrays);
+    memtraceClearRegions();
+    memtraceAddRegion(arrays[0], sizeof(int) * M * N);
+    memtraceAddRegion(arrays[1], sizeof(int) * M * N);
+    memtraceStart();
+    (*func_list[fn].func_ptr)(M, N, arrays[0], arrays[1]);
+    trace = memtraceStop(&count);
+
+    if (cls->check(M, N, arrays) >= 0)
+        return -1;
+
+    if (cacheInit(&cache, s, E, b, POLICY_LRU) < 0) {
+        fprintf(stderr, "transweep: unsupported cache geometry\n");
+        exit(1);
+    }
+    for (k = 0; k < count; k++) {
+        last = (trace[k].addr - base + trace[k].size - 1) >> b;
+        for (blk = (trace[k].addr - base) >> b; blk <= last; blk++)
+            cacheAccess(&cache, blk << b, trace[k].op == 'S', 0, NULL);
+    }
+    misses = cache.misses;
+    cacheFree(&cache);
+    return misses;
+}
+
+/*
+ * sweep_worker - Run jobs until none are left
+ */
+static void *sweep_worker(void *arg)
+{
+    int (*matrices)[MAXN][MAXN];
+    int i;
+
+    (void)arg;
+    if (posix_memalign((void **)&matrices, 4096, 2 * sizeof(*matrices)) != 0) {
+        fprintf(stderr, "transweep: out of memory\n");
+        exit(1);
+    }
+    for (;;) {
+        pthread_mutex_lock(&job_lock);
+        i = next_job++;
+        pthread_mutex_unlock(&job_lock);
+        if (i >= num_jobs)
+            break;
+        jobs[i].misses = simulate(jobs[i].fn, jobs[i].M, jobs[i].N, matrices);
+    }
+    memtraceFree();
+    free(matrices);
+    return NULL;
+}
+
+/*
+ * find_job - The job for function fn on M x N. Jobs are laid out
+ *     function by function, then N, then M.
+ */
+static sweep_job_t *find_job(int fn, int m, int n)
+{
+    return &jobs[(fn * num_sizes + n) * num_sizes + m];
+}
+
+/*
+ * report - Print each function's misses per element over the grid
+ */
+static void report(void)
+{
+    int fn, m, n, wrong, worst_m = 0, worst_n = 0;
+    double per_elem, sum, worst;
+    sweep_job_t *job;
+
+    for (fn = 0; fn < func_counter; fn++) {
+        printf("\nfunc %d (%s)\n", fn, func_list[fn].description);
+        if (num_sizes <= MAX_PRINTED) {
+            printf("  N \\ M");
+            for (m = 0; m < num_sizes; m++)
+                printf(" %5d", sizes[m]);
+            printf("\n");
+        }
+
+        sum = worst = 0;
+        wrong = 0;
+        for (n = 0; n < num_sizes; n++) {
+            if (num_sizes <= MAX_PRINTED)
+                printf("  %5d", sizes[n]);
+            for (m = 0; m < num_sizes; m++) {
+                job = find_job(fn, m, n);
+                if (job->misses < 0) {
+                    wrong++;
+                    if (num_sizes <= MAX_PRINTED)
+                        printf(" %5s", "wrong");
+                    continue;
+                }
+                per_elem = (double)job->misses / (job->M * job->N);
+                sum += per_elem;
+                if (per_elem > worst) {
+                    worst = per_elem;
+                    worst_m = job->M;
+                    worst_n = job->N;
+                }
+                if (num_sizes <= MAX_PRINTED)
+                    printf(" %5.2f", per_elem);
+            }
+            if (num_sizes <= MAX_PRINTED)
+                printf("\n");
+        }
+
+        if (wrong == num_sizes * num_sizes)
+            printf("  wrong on every shape\n");
+        else
+            printf("  mean %.3f misses/elem, worst %.3f at %dx%d, wrong on %d of %d shapes\n",
+                   sum / (num_sizes * num_sizes - wrong), worst, worst_m, worst_n,
+                   wrong, num_sizes * num_sizes);
+    }
+}
+
+/*
+ * write_results - Save the raw counts in the format compare reads
+ */
+static void write_results(const char *name)
+{
+    FILE *fp;
+    int i;
+
+    if ((fp = fopen(name, "w")) == NULL) {
+        perror(name);
+        exit(1);
+    }
+    fprintf(fp, "# transweep s=%d E=%d b=%d simd=%s\n", s, E, b,
+            simdLevelName(simdLevel()));
+    for (i = 0; i < num_jobs; i++)
+        fprintf(fp, "%d %d %d %s\n", jobs[i].M, jobs[i].N, jobs[i].misses,
+                func_list[jobs[i].fn].description);
+    fclose(fp);
+}
+
+/*
+ * open_baseline - Open a baseline written by -o and check that it is
+ *     for the target cache, before any time is spent on the sweep. The
+ *     SIMD level is lowered to the baseline's; level is the one asked
+ *     for with -i, or -1.
+ */
+static FILE *open_baseline(const char *name, int level)
+{
+    char buf[1000], isa[16];
+    int bs, bE, bb, blevel;
+    FILE *fp;
+
+    if ((fp = fopen(name, "r")) == NULL) {
+        perror(name);
+        exit(1);
+    }
+    if (fgets(buf, sizeof(buf), fp) == NULL ||
+        sscanf(buf, "# transweep s=%d E=%d b=%d", &bs, &bE, &bb) != 3) {
+        fprintf(stderr, "transweep: %s is not a transweep baseline\n", name);
+        exit(1);
+    }
+    if (bs != s || bE != E || bb != b) {
+        fprintf(stderr, "transweep: %s is for s=%d, E=%d, b=%d, not s=%d, E=%d, b=%d\n",
+                name, bs, bE, bb, s, E, b);
+        exit(1);
+    }
+    if (sscanf(buf, "# transweep s=%*d E=%*d b=%*d simd=%15s", isa) != 1 ||
+        (blevel = simdParseLevel(isa)) < 0) {
+        fprintf(stderr, "transweep: %s does not name its SIMD level\n", name);
+        exit(1);
+    }
+    if (level >= 0 && level != blevel) {
+        fprintf(stderr, "transweep: %s is for simd=%s, not %s\n",
+                name, isa, simdLevelName(level));
+        exit(1);
+    }
+    if (simdLimitLevel(blevel) != blevel) {
+        fprintf(stderr, "transweep: %s is for simd=%s, which this CPU lacks\n",
+                name, isa);
+        exit(1);
+    }
+    return fp;
+}
+
+/*
+ * compare - Check the counts against the rest of the baseline, matching
+ *     functions by description. Returns the number of regressions.
+ *     Shapes and functions the baseline does not have are skipped.
+ */
+static int compare(FILE *fp, const char *name, double tolerance)
+{
+    char buf[1000], desc[1000];
+    int M, N, misses, fn, m, n, regressions = 0, matched = 0;
+    sweep_job_t *job;
+
+    printf("\nComparing with %s (tolerance %.1f%%)\n", name, tolerance);
+    while (fgets(buf, sizeof(buf), fp) != NULL) {
+        if (sscanf(buf, "%d %d %d %999[^\n]", &M, &N, &misses, desc) != 4)
+            continue;
+        for (fn = 0; fn < func_counter; fn++)
+            if (strcmp(func_list[fn].description, desc) == 0)
+                break;
+        for (m = 0; m < num_sizes && sizes[m] != M; m++)
+            ;
+        for (n = 0; n < num_sizes && sizes[n] != N; n++)
+            ;
+        if (fn == func_counter || m == num_sizes || n == num_sizes)
+            continue;
+
+        job = find_job(fn, m, n);
+        matched++;
+        if (job->misses < 0 && misses >= 0) {
+            printf("REGRESSION func %d (%s) %dx%d: no longer correct\n", fn, desc, M, N);
+            regressions++;
+        } else if (misses >= 0 && job->misses > misses * (1 + tolerance / 100)) {
+            printf("REGRESSION func %d (%s) %dx%d: %d -> %d misses (%+.1f%%)\n",
+                   fn, desc, M, N, misses, job->misses,
+                   misses ? 100.0 * (job->misses - misses) / misses : 100.0);
+            regressions++;
+        }
+    }
+    fclose(fp);
+    printf("%d regressions in %d baseline entries\n", regressions, matched);
+    return regressions;
+}
+
+static void usage(char *argv[])
+{
+    printf("Usage: %s [-h] [-s <s>] [-E <E>] [-b <b>] [-m <min>] [-x <max>] [-k <step>]\n", argv[0]);
+    printf("       [-j <threads>] [-i <isa>] [-o <file>] [-r <file>] [-T <pct>]\n");
+    printf("Options:\n");
+    printf("  -s, -E, -b   Cache to evaluate on (default s=5, E=1, b=5)\n");
+    printf("  -m <min>     Smallest M and N (default 8)\n");
+    printf("  -x <max>     Largest M and N (default %d)\n", MAXN);
+    printf("  -k <step>    Step between sizes (default 8)\n");
+    printf("  -j <n>       Worker threads (default: one per CPU)\n");
+    printf("  -i <isa>     Use at most this instruction set: scalar, sse2 or avx2\n");
+    printf("               (default: the baseline's with -r, else the CPU's best)\n");
+    printf("  -o <file>    Write the miss counts to file\n");
+    printf("  -r <file>    Report regressions against counts written by -o\n");
+    printf("  -T <pct>     Allowed growth over the baseline (default 0)\n");
+    printf("Example: %s -m 1 -x 256 -k 1 -o sweep.txt\n", argv[0]);
+}
+
+int main(int argc, char *argv[])
+{
+    int min = 8, max = MAXN, step = 8, workers = 0, level = -1, fn, m, n, i;
+    char *out_name = NULL, *baseline_name = NULL;
+    double tolerance = 0;
+    FILE *baseline = NULL;
+    pthread_t *tids;
+    sweep_job_t *job;
+    char c;
+
+    while ((c = getopt(argc, argv, "s:E:b:m:x:k:j:i:o:r:T:h")) != -1) {
+        switch (c) {
+        case 's': s = atoi(optarg); break;
+        case 'E': E = atoi(optarg); break;
+        case 'b': b = atoi(optarg); break;
+        case 'm': min = atoi(optarg); break;
+        case 'x': max = atoi(optarg); break;
+        case 'k': step = atoi(optarg); break;
+        case 'j': workers = atoi(optarg); break;
+        case 'i':
+            if ((level = simdParseLevel(optarg)) < 0) {
+                printf("Error: unknown instruction set %s\n", optarg);
+                usage(argv);
+                exit(1);
+            }
+            break;
+        case 'o': out_name = optarg; break;
+        case 'r': baseline_name = optarg; break;
+        case 'T': tolerance = atof(optarg); break;
+        case 'h':
+            usage(argv);
+            exit(0);
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+    if (min <= 0 || max > MAXN || max < min || step <= 0 || workers < 0 ||
+        tolerance < 0 || b < 2) {
+        usage(argv);
+        exit(1);
+    }
+
+    for (i = min; i <= max; i += step)
+        sizes[num_sizes++] = i;
+    if (baseline_name)
+        baseline = open_baseline(baseline_name, level);
+    else if (level >= 0 && simdLimitLevel(level) != level) {
+        fprintf(stderr, "transweep: this CPU lacks %s\n", simdLevelName(level));
+        exit(1);
+    }
+
+    registerFunctions();
+    setTransCache(s, E, b);
+
+    /* One job per function and shape */
+    num_jobs = func_counter * num_sizes * num_sizes;
+    if ((jobs = malloc(num_jobs * sizeof(sweep_job_t))) == NULL) {
+        fprintf(stderr, "transweep: out of memory\n");
+        exit(1);
+    }
+    for (fn = 0; fn < func_counter; fn++) {
+        for (n = 0; n < num_sizes; n++) {
+            for (m = 0; m < num_sizes; m++) {
+                job = find_job(fn, m, n);
+                job->fn = fn;
+                job->M = sizes[m];
+                job->N = sizes[n];
+            }
+        }
+    }
+
+    if (workers == 0)
+        workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (workers > num_jobs)
+        workers = num_jobs;
+    printf("%d functions x %d shapes (%d..%d step %d) on s=%d, E=%d, b=%d, simd=%s, %d threads\n",
+           func_counter, num_sizes * num_sizes, min, max, step, s, E, b,
+           simdLevelName(simdLevel()), workers);
+    fflush(stdout);
+
+    tids = malloc(workers * sizeof(pthread_t));
+    for (i = 0; i < workers; i++) {
+        if (pthread_create(&tids[i], NULL, sweep_worker, NULL) != 0) {
+            fprintf(stderr, "transweep: unable to start worker thread\n");
+            exit(1);
+        }
+    }
+    for (i = 0; i < workers; i++)
+        pthread_join(tids[i], NULL);
+    free(tids);
+
+    /* Compare first, in case -o overwrites the baseline */
+    report();
+    i = baseline ? compare(baseline, baseline_name, tolerance) : 0;
+    if (out_name)
+        write_results(out_name);
+    free(jobs);
+    return i > 0;
+}
@@ -15,6 +15,7 @@
 #include <assert.h>
 #include <float.h>
 #include <time.h>
+#include <fcntl.h>
 
 #include "mm.h"
 #include "memlib.h"
@@ -31,7 +32,7 @@
 #define LINENUM(i) (i+5) /* cnvt trace request nums to linenums (origin 1) */
 
 /* Returns true if p is ALIGNMENT-byte aligned */
-#define IS_ALIGNED(p)  ((((unsigned int)(p)) % ALIGNMENT) == 0)
+#define IS_ALIGNED(p)  ((((size_t)(p)) % ALIGNMENT) == 0)
 
 /****************************** 
  * The key compound data types 
@@ -127,6 +128,8 @@ static void eval_mm_speed(void *ptr);
 
 /* Various helper routines */
 static void printresults(int n, stats_t *stats);
+static void save_results(char *file, int n, char **tracefiles, stats_t *stats);
+static int compare_results(char *file, int n, char **tracefiles, stats_t *stats);
 static void usage(void);
 static void unix_error(char *msg);
 static void malloc_error(int tracenum, int opnum, char *msg);
@@ -150,6 +153,9 @@ int main(int argc, char **argv)
     int team_check = 1;  /* If set, check team structure (reset by -a) */
     int run_libc = 0;    /* If set, run libc malloc (set by -l) */
     int autograder = 0;  /* If set, emit summary info for autograder (-g) */
+    char *save_file = NULL;    /* If set, save the mm results here (-s) */
+    char *compare_file = NULL; /* If set, compare with these results (-c) */
+    int mismatches = 0;  /* traces whose utilization dropped below -c's */
 
     /* temporaries used to compute the performance index */
     double secs, ops, util, avg_mm_util, avg_mm_throughput, p1, p2, perfindex;
@@ -158,7 +164,7 @@ int main(int argc, char **argv)
     /* 
      * Read and interpret the command line arguments 
      */
-    while ((c = getopt(argc, argv, "f:t:hvVgal")) != EOF) {
+    while ((c = getopt(argc, argv, "f:t:s:c:hvVgal")) != EOF) {
         switch (c) {
 	case 'g': /* Generate summary info for the autograder */
 	    autograder = 1;
@@ -178,6 +184,12 @@ int main(int argc, char **argv)
 	    if (tracedir[strlen(tracedir)-1] != '/') 
 		strcat(tracedir, "/"); /* path always ends with "/" */
 	    break;
+        case 's': /* Save the mm results for a later -c */
+            save_file = optarg;
+            break;
+        case 'c': /* Compare the mm results with those saved by -s */
+            compare_file = optarg;
+            break;
         case 'a': /* Don't check team structure */
             team_check = 0;
             break;
@@ -314,6 +326,13 @@ int main(int argc, char **argv)
 	printf("\n");
     }
 
+    /* Save the mm results or check them against earlier ones */
+    if (save_file != NULL)
+	save_results(save_file, num_tracefiles, tracefiles, mm_stats);
+    if (compare_file != NULL)
+	mismatches = compare_results(compare_file, num_tracefiles,
+				     tracefiles, mm_stats);
+
     /* 
      * Accumulate the aggregate statistics for the student's mm package 
      */
@@ -362,7 +381,7 @@ int main(int argc, char **argv)
 	printf("perfidx:%.0f\n", perfindex);
     }
 
-    exit(0);
+    exit(mismatches ? 1 : 0);
 }
 
 
@@ -972,6 +991,106 @@ static void printresults(int n, stats_t *stats)
 
 }
 
+/*
+ * trace_name - The name of a trace file without its directory, as saved
+ *     by -s, so that results can be compared whether or not -f was used
+ */
+static char *trace_name(char *tracefile)
+{
+    char *slash = strrchr(tracefile, '/');
+
+    return slash ? slash + 1 : tracefile;
+}
+
+/*
+ * save_results - Write the utilization and throughput of each valid
+ *     trace to file, one "tracefile util Kops" line per trace. An
+ *     existing file is never overwritten, so that a reference such as
+ *     ref-results.txt stays what it was saved from.
+ */
+static void save_results(char *file, int n, char **tracefiles, stats_t *stats)
+{
+    FILE *fp;
+    int fd, i;
+
+    if ((fd = open(file, O_WRONLY | O_CREAT | O_EXCL, 0644)) < 0 ||
+	(fp = fdopen(fd, "w")) == NULL)
+	unix_error("Could not create results file");
+    fprintf(fp, "# mdriver results: tracefile util Kops\n");
+    for (i=0; i < n; i++)
+	if (stats[i].valid)
+	    fprintf(fp, "%s %.6f %.0f\n", trace_name(tracefiles[i]), stats[i].util,
+		    (stats[i].ops/1e3)/stats[i].secs);
+    fclose(fp);
+}
+
+/*
+ * compare_results - Compare each valid trace with the results saved
+ *     in file by -s, typically from an earlier version of the allocator.
+ *     Utilization must not drop below the saved one. Throughput depends
+ *     on the machine, so the saved Kops are only shown, for runs on the
+ *     machine that saved them. Returns the number of traces whose
+ *     utilization dropped.
+ */
+static int compare_results(char *file, int n, char **tracefiles, stats_t *stats)
+{
+    FILE *fp;
+    char line[MAXLINE], name[MAXLINE];
+    double util, diff, kops, ref_ops = 0, ref_secs = 0, ops = 0, secs = 0;
+    int i, found, mismatches = 0;
+
+    if ((fp = fopen(file, "r")) == NULL)
+	unix_error("Could not open results file for reading");
+
+    printf("\nComparison with %s:\n", file);
+    printf("%5s%7s%7s%8s%8s%8s\n", 
+	   "trace", "util", "ref", "Kops", "ref", "speedup");
+    for (i=0; i < n; i++) {
+	if (!stats[i].valid)
+	    continue;
+	found = 0;
+	rewind(fp);
+	while (fgets(line, MAXLINE, fp) != NULL) {
+	    if (line[0] == '#')
+		continue;
+	    if (sscanf(line, "%s %lf %lf", name, &util, &kops) == 3 &&
+		!strcmp(name, trace_name(tracefiles[i]))) {
+		found = 1;
+		break;
+	    }
+	}
+	if (!found) {
+	    printf("%2d  no results for %s\n", i, trace_name(tracefiles[i]));
+	    continue;
+	}
+	diff = util - stats[i].util;
+	printf("%2d%9.2f%%%6.2f%%%8.0f%8.0f%8.2f%s\n",
+	       i,
+	       stats[i].util*100.0,
+	       util*100.0,
+	       (stats[i].ops/1e3)/stats[i].secs,
+	       kops,
+	       (stats[i].ops/1e3)/stats[i].secs/kops,
+	       diff > 5e-7 ? "  utilization dropped" : "");
+	if (diff > 5e-7)
+	    mismatches++;
+	ops += stats[i].ops;
+	secs += stats[i].secs;
+	ref_ops += stats[i].ops;
+	ref_secs += stats[i].ops/1e3/kops;
+    }
+    fclose(fp);
+
+    if (secs > 0 && ref_secs > 0)
+	printf("%12s%8.0f%8.0f%8.2f\n", "Total       ",
+	       (ops/1e3)/secs, (ref_ops/1e3)/ref_secs,
+	       ((ops/1e3)/secs)/((ref_ops/1e3)/ref_secs));
+    printf("Kops are only comparable on the machine that saved %s\n", file);
+    if (mismatches)
+	printf("Utilization dropped below %s on %d traces\n", file, mismatches);
+    return mismatches;
+}
+
 /* 
  * app_error - Report an arbitrary application error
  */
@@ -1004,13 +1123,15 @@ void malloc_error(int tracenum, int opnum, char *msg)
  */
 static void usage(void) 
 {
-    fprintf(stderr, "Usage: mdriver [-hvVal] [-f <file>] [-t <dir>]\n");
+    fprintf(stderr, "Usage: mdriver [-hvVal] [-f <file>] [-t <dir>] [-s <file>] [-c <file>]\n");
     fprintf(stderr, "Options\n");
     fprintf(stderr, "\t-a         Don't check the team structure.\n");
+    fprintf(stderr, "\t-c <file>  Fail if utilization drops below <file>.\n");
     fprintf(stderr, "\t-f <file>  Use <file> as the trace file.\n");
     fprintf(stderr, "\t-g         Generate summary info for autograder.\n");
     fprintf(stderr, "\t-h         Print this message.\n");
     fprintf(stderr, "\t-l         Run libc malloc as well.\n");
+    fprintf(stderr, "\t-s <file>  Save utilization and throughput to new <file>.\n");
     fprintf(stderr, "\t-t <dir>   Directory to find default traces.\n");
     fprintf(stderr, "\t-v         Print per-trace performance breakdowns.\n");
     fprintf(stderr, "\t-V         Print additional debug info.\n");
@@ -1,13 +1,25 @@
 /*
- * mm-naive.c - The fastest, least memory-efficient malloc package.
- * 
- * In this naive approach, a block is allocated by simply incrementing
- * the brk pointer.  A block is pure payload. There are no headers or
- * footers.  Blocks are never coalesced or reused. Realloc is
- * implemented directly using mm_malloc and mm_free.
+ * mm.c - A segregated-fit allocator with boundary-tag coalescing.
  *
- * NOTE TO STUDENTS: Reuse_block this header comment with your own header
- * comment that gives a high level description of your solution.
+ * Blocks are 8-byte aligned and start with a 4-byte header holding the
+ * block size, bit 0 set if the block is allocated and bit 1 set if the
+ * previous block is. Allocated blocks have no footer, so a block needs
+ * only its payload plus the header, and at least 16 bytes. Free blocks
+ * repeat the size in a footer, which coalesce reads only when bit 1 of
+ * the next header says the block is free.
+ *
+ * Free blocks sit in 64 doubly linked bins: one per size from 16 to 120
+ * bytes, then four per power of two, the last open-ended. A 64-bit map
+ * has bit i set while bin i is non-empty, so find_fit tries the first
+ * few blocks of the bin of the requested size and otherwise takes the
+ * first block of the lowest non-empty bin above it, where every block
+ * fits.
+ *
+ * The bin links are 32-bit offsets from the start of the heap rather
+ * than pointers, so a free block holds them in 16 bytes on 64-bit too.
+ *
+ * Freed blocks are coalesced with free neighbours at once. mm_realloc
+ * resizes a block in place when it can and moves it otherwise.
  */
 #include <stdio.h>
 #include <stdlib.h>
@@ -39,10 +51,21 @@ team_t team = {
 /* Constants and macros */
 #define ALIGNMENT 8
 #define WSIZE 4 /* Word & header/footer size in Byte */
+#define MIN_BLOCK (WSIZE * 4) /* Header, two free list links and footer */
 #define CHUNKSIZE (1<<12) /* Chunk size in Byte */
 
+/* Free list bins */
+#define NUM_BINS 64 /* One bit each in sg_bin_map */
+#define NUM_EXACT_BINS 14 /* One bin per block size from 16 to 120 Byte */
+#define LOG_BIN_SIZE 128 /* Smallest size binned by its power of two */
+#define LOG_BIN_SHIFT 7 /* log2(LOG_BIN_SIZE) */
+#define SUB_BIN_BITS 2 /* Each power of two is split into 4 bins */
+#define BIN_SCAN 4 /* Blocks tried in the bin of the requested size */
+
 /* Global variables */
-static char *sg_free_list[13];
+static char *sg_free_list[NUM_BINS];
+static unsigned long long sg_bin_map; /* Bit i set when bin i is non-empty */
+static char *sg_heap_lo; /* Base of the free list links */
 
 /* Helper functions for block management */
 static void mm_put(char *ptr, unsigned int val)
@@ -55,6 +78,16 @@ static unsigned int mm_get(char *ptr)
     return *(unsigned int *)ptr;
 }
 
+/*
+ * Only free blocks have a footer. Bit 1 of every header records whether
+ * the previous block is allocated, so coalesce reads the footer of the
+ * previous block only when it is free.
+ */
+static unsigned int build_header(size_t size, int prev_alloc, int alloc)
+{
+    return size | (prev_alloc << 1) | alloc;
+}
+
 static unsigned int build_header_footer(size_t size, int alloc)
 {
     return size | alloc;
@@ -75,6 +108,16 @@ static int get_alloc(char *block)
     return mm_get(block - WSIZE) & 0x1;
 }
 
+static int get_prev_alloc(char *block)
+{
+    return (mm_get(block - WSIZE) >> 1) & 0x1;
+}
+
+static void set_prev_alloc(char *block, int prev_alloc)
+{
+    mm_put(block - WSIZE, (mm_get(block - WSIZE) & ~0x2) | (prev_alloc << 1));
+}
+
 static char *get_next_block(char *block)
 {
     return block + get_block_size(block);
@@ -95,24 +138,40 @@ static char *get_prev_free_addr(char *block)
     return block;
 }
 
+/*
+ * Free list links are stored as 32-bit offsets from the start of the heap,
+ * so that a free block still needs only 16 bytes with 64-bit pointers.
+ * Offset 0 is the padding word before the prologue, never a block, and
+ * stands for NULL.
+ */
+static char *link_to_block(unsigned int offset)
+{
+    return offset ? sg_heap_lo + offset : NULL;
+}
+
+static unsigned int block_to_link(char *block)
+{
+    return block ? (unsigned int)(block - sg_heap_lo) : 0;
+}
+
 static char *get_next_free(char *block)
 {
-    return *(char**)(get_next_free_addr(block));
+    return link_to_block(mm_get(get_next_free_addr(block)));
 }
 
 static char *get_prev_free(char *block)
 {
-    return *(char**)(get_prev_free_addr(block));
+    return link_to_block(mm_get(get_prev_free_addr(block)));
 }
 
 static void set_next_free(char *block, char *next)
 {
-    mm_put(get_next_free_addr(block), (unsigned int)next);
+    mm_put(get_next_free_addr(block), block_to_link(next));
 }
 
 static void set_prev_free(char *block, char *prev)
 {
-    mm_put(get_prev_free_addr(block), (unsigned int)prev);
+    mm_put(get_prev_free_addr(block), block_to_link(prev));
 }
 
 static void *get_header_addr(char *block)
@@ -126,125 +185,127 @@ static void *get_footer_addr(char *block)
 }
 
 /* Helper functions for free list management */
-static void init_free_list()
+static int find_list_index(size_t size)
 {
-    for (int i = 0; i < 13; i++)
-        sg_free_list[i] = NULL;
+    int log, index;
+
+    if (size < LOG_BIN_SIZE)
+        return (size >> 3) - 2;
+
+    log = 31 - __builtin_clz((unsigned int)size);
+    index = NUM_EXACT_BINS + ((log - LOG_BIN_SHIFT) << SUB_BIN_BITS)
+        + ((size >> (log - SUB_BIN_BITS)) & ((1 << SUB_BIN_BITS) - 1));
+    return index < NUM_BINS ? index : NUM_BINS - 1;
 }
 
-static int find_list_index(size_t size)
+static void init_free_list()
 {
-    int index = 0;
-    while (size > 1 && index < 12)
-    {
-        size >>= 1;
-        index++;
-    }
-    return index;
+    for (int i = 0; i < NUM_BINS; i++)
+        sg_free_list[i] = NULL;
+    sg_bin_map = 0;
 }
 
 static void insert_free_block(char *block)
 {
-    size_t size = get_block_size(block);
-    int index = find_list_index(size);
-    char *root = sg_free_list[index];
-    char *prev = NULL;
-    char *next = root;
-    while (next)
-    {
-        if (size < get_block_size(next))
-            break;
-        prev = next;
-        next = get_next_free(next);
-    }
+    int index = find_list_index(get_block_size(block));
+    char *next = sg_free_list[index];
 
-    if (next == root)
-        sg_free_list[index] = block;
-
-    set_prev_free(block, prev);
+    set_prev_free(block, NULL);
     set_next_free(block, next);
 
-    if (prev)
-        set_next_free(prev, block);
-
     if (next)
         set_prev_free(next, block);
+
+    sg_free_list[index] = block;
+    sg_bin_map |= 1ULL << index;
 }
 
 static void remove_free_block(char *block)
 {
-    size_t size = get_block_size(block);
-    int index = find_list_index(size);
+    int index = find_list_index(get_block_size(block));
     char *prev = get_prev_free(block);
     char *next = get_next_free(block);
 
     if (prev)
         set_next_free(prev, next);
-    else
-        sg_free_list[index] = next;
+    else if ((sg_free_list[index] = next) == NULL)
+        sg_bin_map &= ~(1ULL << index);
 
     if (next)
         set_prev_free(next, prev);
 }
 
+/*
+ * find_fit - Every block in a bin above the one for size is large enough,
+ *     so the first of the lowest non-empty one fits. The bin for size
+ *     itself may hold smaller blocks, so its first few are tried before.
+ */
 static char *find_fit(size_t size)
 {
     int index = find_list_index(size);
-    for (int i = index; i < 13; i++)
+    int scan = index == NUM_BINS - 1 ? -1 : BIN_SCAN;
+    unsigned long long above;
+    char *block;
+
+    for (block = sg_free_list[index]; block && scan != 0; scan--)
     {
-        char *block = sg_free_list[i];
-        while (block)
-        {
-            if (get_block_size(block) >= size)
-                return block;
-            block = get_next_free(block);
-        }
+        if (get_block_size(block) >= size)
+            return block;
+        block = get_next_free(block);
     }
-    return NULL;
+
+    if (index == NUM_BINS - 1)
+        return NULL;
+
+    above = sg_bin_map & (~0ULL << (index + 1));
+    if (above == 0)
+        return NULL;
+
+    return sg_free_list[__builtin_ctzll(above)];
 }
 
 static void use_block(void *block, size_t size) {
 
     size_t block_size = get_block_size(block);
     size_t remain_size = block_size - size;
+    int prev_alloc = get_prev_alloc(block);
 
     remove_free_block(block);
 
-    if (remain_size >= WSIZE * 4)
+    if (remain_size >= MIN_BLOCK)
     {
-        mm_put(get_header_addr(block), build_header_footer(size, 1));
-        mm_put(get_footer_addr(block), build_header_footer(size, 1));
+        mm_put(get_header_addr(block), build_header(size, prev_alloc, 1));
 
         char *next_block = get_next_block(block);
-        mm_put(get_header_addr(next_block), build_header_footer(remain_size, 0));
+        mm_put(get_header_addr(next_block), build_header(remain_size, 1, 0));
         mm_put(get_footer_addr(next_block), build_header_footer(remain_size, 0));
 
         insert_free_block(next_block);
     }
     else
     {
-        mm_put(get_header_addr(block), build_header_footer(block_size, 1));
-        mm_put(get_footer_addr(block), build_header_footer(block_size, 1));
+        mm_put(get_header_addr(block), build_header(block_size, prev_alloc, 1));
+        set_prev_alloc(get_next_block(block), 1);
     }
 }
 
 /* Helper functions for heap management */
 static char *coalesce(char *block){
 
-    char *prev_block = get_prev_block(block);
     char *next_block = get_next_block(block);
-    size_t prev_alloc = get_alloc(prev_block);
-    size_t next_alloc = get_alloc(next_block);
+    int prev_alloc = get_prev_alloc(block);
+    int next_alloc = get_alloc(next_block);
     size_t size = get_block_size(block);
     size_t new_size = size;
 
-    char *new_header_addr = prev_alloc ? get_header_addr(block) : get_header_addr(prev_block);
+    char *new_block = prev_alloc ? block : get_prev_block(block);
+    char *new_header_addr = get_header_addr(new_block);
     char *new_footer_addr = next_alloc ? get_footer_addr(block) : get_footer_addr(next_block);
 
     if (!prev_alloc)
     {
-        new_size += get_block_size(prev_block);
-        remove_free_block(prev_block);
+        new_size += get_block_size(new_block);
+        remove_free_block(new_block);
     }
 
     if (!next_alloc)
@@ -253,44 +314,93 @@ static char *coalesce(char *block){
         remove_free_block(next_block);
     }
 
-    mm_put(new_header_addr, build_header_footer(new_size, 0));
+    mm_put(new_header_addr, build_header(new_size, get_prev_alloc(new_block), 0));
     mm_put(new_footer_addr, build_header_footer(new_size, 0));
 
-    insert_free_block(new_header_addr + WSIZE);
-    return new_header_addr + WSIZE;
+    insert_free_block(new_block);
+    return new_block;
 }
 
-static char *extend_heap(size_t words)
+static char *extend_heap(size_t bytes)
 {
     size_t size;
     void *block;
 
-    size = words % 8 == 0 ? words : (words + 8 - (words % 8));
+    size = bytes % 8 == 0 ? bytes : (bytes + 8 - (bytes % 8));
     if ((block = mem_sbrk(size)) == (void *)-1)
         return NULL;
 
-    mm_put(get_header_addr(block), build_header_footer(size, 0));
+    mm_put(get_header_addr(block), build_header(size, get_prev_alloc(block), 0));
     mm_put(get_footer_addr(block), build_header_footer(size, 0));
-    mm_put(get_header_addr(get_next_block(block)), build_header_footer(0, 1));
+    mm_put(get_header_addr(get_next_block(block)), build_header(0, 0, 1));
 
     return coalesce(block);
 }
 
+/*
+ * extend_tail - Extend the heap just enough for a free block of size at its
+ *     end, counting the free block already there if any
+ */
+static char *extend_tail(size_t size)
+{
+    char *epilogue = (char *)mem_heap_hi() + 1;
+    size_t tail_size = get_prev_alloc(epilogue) ? 0 : get_size(epilogue - WSIZE * 2);
+
+    if (tail_size >= size)
+        return get_prev_block(epilogue);
+
+    size -= tail_size;
+    return extend_heap(size > MIN_BLOCK ? size : MIN_BLOCK);
+}
+
+/*
+ * shrink_block - Split the tail past size off an allocated block and free
+ *     it, merged with the block after it if that one is free.
+ */
+static void shrink_block(char *block, size_t size)
+{
+    size_t remain_size = get_block_size(block) - size;
+
+    if (remain_size < MIN_BLOCK)
+        return;
+
+    mm_put(get_header_addr(block), build_header(size, get_prev_alloc(block), 1));
+
+    char *next_block = get_next_block(block);
+    mm_put(get_header_addr(next_block), build_header(remain_size, 1, 0));
+    mm_put(get_footer_addr(next_block), build_header_footer(remain_size, 0));
+    set_prev_alloc(get_next_block(next_block), 0);
+
+    coalesce(next_block);
+}
+
+/*
+ * adjust_size - Block size for a payload of size bytes
+ */
+static size_t adjust_size(size_t size)
+{
+    size_t block_size = size + WSIZE;
+
+    block_size = block_size % 8 == 0 ? block_size : (block_size + 8 - (block_size % 8));
+    return block_size < MIN_BLOCK ? MIN_BLOCK : block_size;
+}
+
 /* 
  * mm_init - initialize the malloc package.
  */
 int mm_init(void)
 {   
     init_free_list();
+    sg_heap_lo = mem_heap_lo();
 
     char *block = mem_sbrk(4 * WSIZE);
     if (block == (void *)-1)
         return -1;
 
     mm_put(block, 0);
-    mm_put(block + WSIZE, build_header_footer(WSIZE * 2, 1));
+    mm_put(block + WSIZE, build_header(WSIZE * 2, 1, 1));
     mm_put(block + WSIZE * 2, build_header_footer(WSIZE * 2, 1));
-    mm_put(block + WSIZE * 3, build_header_footer(0, 1));
+    mm_put(block + WSIZE * 3, build_header(0, 1, 1));
 
     if (extend_heap(CHUNKSIZE) == NULL)
         return -1;
@@ -299,8 +409,8 @@ int mm_init(void)
 }
 
 /* 
- * mm_malloc - Allocate a block by incrementing the brk pointer.
- *     Always allocate a block whose size is a multiple of the alignment.
+ * mm_malloc - Allocate a block from the first fit find_fit gives, or
+ *     from new heap space when none fits.
  */
 void *mm_malloc(size_t size)
 {
@@ -311,8 +421,7 @@ void *mm_malloc(size_t size)
     if (size == 0)
         return NULL;
 
-    block_size = size % 8 == 0 ? size : (size + 8 - (size % 8));
-    block_size += WSIZE * 2;
+    block_size = adjust_size(size);
 
     if ((block = find_fit(block_size)) != NULL)
     {
@@ -329,23 +438,31 @@ void *mm_malloc(size_t size)
 }
 
 /*
- * mm_free - Freeing a block does nothing.
+ * mm_free - Free a block and coalesce it with its free neighbours.
  */
 void mm_free(void *bp)
 {
-    mm_put(get_header_addr(bp), build_header_footer(get_block_size(bp), 0));
-    mm_put(get_footer_addr(bp), build_header_footer(get_block_size(bp), 0));
+    size_t size = get_block_size(bp);
+
+    mm_put(get_header_addr(bp), build_header(size, get_prev_alloc(bp), 0));
+    mm_put(get_footer_addr(bp), build_header_footer(size, 0));
+    set_prev_alloc(get_next_block(bp), 0);
 
     coalesce(bp);
 }
 
 /*
- * mm_realloc - Implemented simply in terms of mm_malloc and mm_free
+ * mm_realloc - Resize the block in place when possible: shrink it by
+ *     splitting off its tail, or grow it into a free successor, extending
+ *     the heap first when the block or that successor is the last one.
+ *     Otherwise move the payload to a new block.
  */
 void *mm_realloc(void *ptr, size_t size)
 {
     void *newptr;
     size_t copySize;
+    size_t block_size, old_size, avail_size;
+    char *next_block;
 
     if (size == 0)
     {
@@ -356,10 +473,44 @@ void *mm_realloc(void *ptr, size_t size)
     if (ptr == NULL)
         return mm_malloc(size);
 
-    if ((newptr = mm_malloc(size)) == NULL)
+    block_size = adjust_size(size);
+    old_size = get_block_size(ptr);
+
+    if (block_size <= old_size)
+    {
+        shrink_block(ptr, block_size);
+        return ptr;
+    }
+
+    next_block = get_next_block(ptr);
+    avail_size = old_size + (get_alloc(next_block) ? 0 : get_block_size(next_block));
+
+    if (avail_size < block_size &&
+        (get_block_size(next_block) == 0 ||
+         (!get_alloc(next_block) && get_block_size(get_next_block(next_block)) == 0)))
+    {
+        if (extend_tail(block_size - old_size) == NULL)
+            return NULL;
+        avail_size = old_size + get_block_size(next_block);
+    }
+
+    if (avail_size >= block_size)
+    {
+        remove_free_block(next_block);
+        mm_put(get_header_addr(ptr), build_header(avail_size, get_prev_alloc(ptr), 1));
+        set_prev_alloc(get_next_block(ptr), 1);
+        shrink_block(ptr, block_size);
+        return ptr;
+    }
+
+    /* A block that has to move goes to the end of the heap when nothing
+       fits, with no slack after it, so that it can grow in place next time */
+    if ((newptr = find_fit(block_size)) == NULL &&
+        (newptr = extend_tail(block_size)) == NULL)
         return NULL;
+    use_block(newptr, block_size);
 
-    copySize = get_size(ptr) - WSIZE * 2;
+    copySize = old_size - WSIZE;
     if (size < copySize)
         copySize = size;
 
@@ -367,4 +518,4 @@ void *mm_realloc(void *ptr, size_t size)
     mm_free(ptr);
 
     return newptr;
-}
\ No newline at end of file
+}